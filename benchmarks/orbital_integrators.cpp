@@ -0,0 +1,372 @@
+// Integrator benchmark for the Orbital simulation.
+// Integrates the OrbitalChaosApp solar system (sun + 8 eccentric planets)
+// for a fixed time with every integrator and several step sizes, and reports
+// force evaluations against the worst relative energy error.
+// Force evaluations are counted in whole-system units (body evaluations / N),
+// so the partial updates of the block-timestep Hermite scheme compare fairly;
+// note that a Hermite evaluation also computes the jerk.
+// In single precision, below some step size round-off, not truncation,
+// dominates the error; the second table shows what compensated drifts and
+// double precision buy there. Then a close binary is regularized, a Parareal
+// run is compared with the serial fine integration it replaces, and the
+// substep controller is compared with the app's old fixed 40 substeps.
+// Then each direct-summation kernel the CPU supports reports its pair
+// throughput and its deviation from the scalar one, and last, heap
+// allocations are counted over steps that should make none.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "Common/ThreadPool.h"
+#include "Orbital_Chaos/GravityKernels.h"
+#include "Orbital_Chaos/Parareal.h"
+#include "Orbital_Chaos/PhysicsWorld.h"
+#include "Orbital_Chaos/SubstepController.h"
+
+// Every heap allocation of the process, for the allocation check
+static std::atomic<unsigned long long> allocations{ 0 };
+
+void* operator new(std::size_t size)
+{
+    allocations++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+    // Same system as OrbitalChaosApp::setup_bodies
+    std::vector<CelestialBody> make_solar_system()
+    {
+        std::vector<CelestialBody> bodies;
+
+        CelestialBody sun({ 600.f, 450.f }, { 0.f, 0.f });
+        sun.set_mass(5000.f);
+        bodies.push_back(sun);
+
+        const float perihelion[8] = { 60.f, 100.f, 130.f, 170.f, 230.f, 280.f, 320.f, 360.f };
+        const float semi_major[8] = { 110.f, 150.f, 190.f, 240.f, 320.f, 370.f, 410.f, 450.f };
+
+        for (int p = 0; p < 8; p++) {
+            float v_peri = std::sqrt(PhysicsConstants::G * sun.get_mass() *
+                (2.0f / perihelion[p] - 1.0f / semi_major[p]));
+
+            CelestialBody planet({ 600.f + perihelion[p], 450.f }, { 0.f, -v_peri });
+            planet.set_mass(1.f);
+            bodies.push_back(planet);
+        }
+        return bodies;
+    }
+
+    // Tight equal-mass binary (period ~1.8) with light bodies orbiting it
+    std::vector<CelestialBody> make_binary_cluster()
+    {
+        std::vector<CelestialBody> bodies;
+
+        CelestialBody a({ 500.f, 500.f }, { 0.f, -3.5355f });
+        a.set_mass(50.f);
+        CelestialBody b({ 502.f, 500.f }, { 0.f, 3.5355f });
+        b.set_mass(50.f);
+        bodies.push_back(a);
+        bodies.push_back(b);
+
+        for (int k = 0; k < 30; k++) {
+            float r = 60.f + 6.5f * k;
+            float phi = 2.3999632f * k;   // golden angle
+            float v = std::sqrt(PhysicsConstants::G * 100.f / r);
+
+            CelestialBody body({ 501.f + r * std::cos(phi), 500.f + r * std::sin(phi) },
+                { -v * std::sin(phi), v * std::cos(phi) });
+            body.set_mass(0.1f);
+            bodies.push_back(body);
+        }
+        return bodies;
+    }
+
+    // Equal bodies on circular orbits around a central mass, enough of them
+    // for the SIMD force kernels
+    std::vector<CelestialBody> make_disk(size_t count)
+    {
+        std::vector<CelestialBody> bodies;
+
+        CelestialBody sun({ 600.f, 450.f }, { 0.f, 0.f });
+        sun.set_mass(5000.f);
+        bodies.push_back(sun);
+
+        for (size_t k = 1; k < count; k++) {
+            float r = 80.f + 400.f * float(k) / float(count);
+            float phi = 2.3999632f * float(k);   // golden angle
+            float v = std::sqrt(PhysicsConstants::G * sun.get_mass() / r);
+
+            CelestialBody body({ 600.f + r * std::cos(phi), 450.f + r * std::sin(phi) },
+                { -v * std::sin(phi), v * std::cos(phi) });
+            body.set_mass(0.1f);
+            bodies.push_back(body);
+        }
+        return bodies;
+    }
+
+    // Heap allocations over steps after a warm-up (which sizes the buffers)
+    unsigned long long count_allocations(PhysicsWorld& world, std::vector<CelestialBody>& bodies, unsigned int steps)
+    {
+        for (unsigned int s = 0; s < 4; s++)
+            world.update_physics(bodies, 0.05f);
+
+        const unsigned long long before = allocations;
+        for (unsigned int s = 0; s < steps; s++)
+            world.update_physics(bodies, 0.05f);
+        return allocations - before;
+    }
+
+    struct Result {
+        unsigned long long evals;
+        double max_drift;
+        double milliseconds;
+    };
+
+    template <typename World>
+    Result run(Integrator integrator, double dt, double duration, bool compensated,
+        bool binary = false, bool regularized = false)
+    {
+        std::vector<CelestialBody> bodies = binary ? make_binary_cluster() : make_solar_system();
+        World world;
+        world.set_integrator(integrator);
+        world.set_compensated_drift(compensated);
+        world.set_regularization(regularized);
+
+        const double e0 = world.total_energy(bodies);
+        const long step_count = static_cast<long>(duration / dt);
+        double max_drift = 0.0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (long s = 0; s < step_count; s++) {
+            world.update_physics(bodies, static_cast<typename World::Scalar>(dt));
+            if (s % 16 == 0)
+                max_drift = std::max(max_drift, std::abs((world.total_energy(bodies) - e0) / e0));
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        return { world.get_body_evaluations() / bodies.size(), max_drift,
+            std::chrono::duration<double, std::milli>(end - start).count() };
+    }
+}
+
+int main()
+{
+    // About 10 Mercury orbits and one Neptune orbit
+    const double DURATION = 1000.0;
+    const float steps[] = { 12.8f, 6.4f, 3.2f, 1.6f, 0.8f, 0.4f, 0.2f, 0.1f, 0.05f };
+    const Integrator integrators[] = {
+        Integrator::VelocityVerlet, Integrator::ForestRuth, Integrator::PEFRL,
+        Integrator::Yoshida4, Integrator::Yoshida6, Integrator::WisdomHolman, Integrator::HermiteBlock
+    };
+
+    // Summary: cheapest run of each integrator below this error
+    const double TARGET_DRIFT = 1e-4;
+
+    std::printf("%-16s %8s %10s %12s %14s %10s\n", "integrator", "dt", "force evals", "max |dE/E|", "evals x drift", "time ms");
+
+    std::vector<unsigned long long> cheapest(sizeof(integrators) / sizeof(integrators[0]), 0);
+
+    for (size_t k = 0; k < cheapest.size(); k++) {
+        const Integrator integrator = integrators[k];
+        for (float dt : steps) {
+            Result r = run<PhysicsWorld>(integrator, dt, DURATION, false);
+
+            // Lower is better: cost to reach a given accuracy
+            std::printf("%-16s %8.4f %10llu %12.3e %14.3e %10.1f\n", integrator_name(integrator), dt,
+                r.evals, r.max_drift, r.evals * r.max_drift, r.milliseconds);
+
+            if (r.max_drift < TARGET_DRIFT && (cheapest[k] == 0 || r.evals < cheapest[k]))
+                cheapest[k] = r.evals;
+        }
+    }
+
+    std::printf("\nForce evaluations to keep |dE/E| below %.0e over t = %.0f:\n", TARGET_DRIFT, DURATION);
+    for (size_t k = 0; k < cheapest.size(); k++) {
+        if (cheapest[k])
+            std::printf("  %-16s %llu\n", integrator_name(integrators[k]), cheapest[k]);
+        else
+            std::printf("  %-16s not reached\n", integrator_name(integrators[k]));
+    }
+
+    // Round-off: small PEFRL steps, where float error no longer shrinks with dt
+    std::printf("\n%-22s %8s %12s %10s\n", "PEFRL precision", "dt", "max |dE/E|", "time ms");
+    for (float dt : { 0.2f, 0.05f, 0.0125f }) {
+        Result f = run<PhysicsWorld>(Integrator::PEFRL, dt, DURATION, false);
+        Result k = run<PhysicsWorld>(Integrator::PEFRL, dt, DURATION, true);
+        Result d = run<PhysicsWorldDouble>(Integrator::PEFRL, dt, DURATION, false);
+        std::printf("%-22s %8.4f %12.3e %10.1f\n", "float", dt, f.max_drift, f.milliseconds);
+        std::printf("%-22s %8.4f %12.3e %10.1f\n", "float + Kahan drifts", dt, k.max_drift, k.milliseconds);
+        std::printf("%-22s %8.4f %12.3e %10.1f\n", "double", dt, d.max_drift, d.milliseconds);
+    }
+
+    // Close pair: the global step no longer has to resolve the binary orbit
+    std::printf("\n%-22s %8s %12s %10s\n", "Binary, PEFRL (double)", "dt", "max |dE/E|", "time ms");
+    for (float dt : { 0.4f, 0.2f, 0.05f }) {
+        Result plain = run<PhysicsWorldDouble>(Integrator::PEFRL, dt, 100.0, false, true, false);
+        Result regularized = run<PhysicsWorldDouble>(Integrator::PEFRL, dt, 100.0, false, true, true);
+        std::printf("%-22s %8.4f %12.3e %10.1f\n", "direct", dt, plain.max_drift, plain.milliseconds);
+        std::printf("%-22s %8.4f %12.3e %10.1f\n", "Levi-Civita pairs", dt, regularized.max_drift, regularized.milliseconds);
+    }
+
+    // Parareal: 32 slices of 200 PEFRL steps; the speedup is the one the
+    // run measured, assuming one core per slice
+    const unsigned int SLICES = 32, FINE_STEPS = 200;
+    std::vector<CelestialBody> serial = make_solar_system();
+    PhysicsWorldDouble reference;
+    reference.set_integrator(Integrator::PEFRL);
+    for (unsigned int s = 0; s < SLICES * FINE_STEPS; s++)
+        reference.update_physics(serial, DURATION / (SLICES * FINE_STEPS));
+    std::vector<double> expected;
+    reference.get_state(serial, expected);
+
+    ThreadPool pool;
+    std::printf("\n%-22s %6s %10s %8s %14s %10s %10s\n", "Parareal, 32 slices", "coarse", "iterations", "serial",
+        "max |x - serial|", "speedup", "time ms");
+    for (Integrator coarse : { Integrator::VelocityVerlet, Integrator::WisdomHolman }) {
+        for (unsigned int coarse_steps : { 4u, 16u }) {
+            std::vector<CelestialBody> bodies = make_solar_system();
+            Parareal<double> parareal;
+            parareal.set_slices(SLICES);
+            parareal.set_fine(Integrator::PEFRL, FINE_STEPS);
+            parareal.set_coarse(coarse, coarse_steps);
+            parareal.set_thread_pool(&pool);
+
+            auto start = std::chrono::steady_clock::now();
+            unsigned int iterations = parareal.integrate(bodies, DURATION);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            double error = 0.0;
+            const std::vector<double>& state = parareal.get_final_state();
+            for (size_t c = 0; c < state.size(); c++)
+                error = std::max(error, std::abs(state[c] - expected[c]));
+
+            std::printf("%-22s %6u %10u %8u %14.3e %10.2f %10.1f\n", integrator_name(coarse), coarse_steps, iterations,
+                parareal.get_serial_slices(), error, parareal.get_speedup(), ms);
+        }
+    }
+
+    // Substeps per 60 Hz frame at the app's time scale: fixed, or chosen
+    // from the energy / angular-momentum change of the previous frame
+    const double FRAME_TIME = 10.2 / 60.0;
+    const unsigned int FRAMES = 6000;
+    std::printf("\n%-22s %10s %8s %8s %12s\n", "Frames (double)", "substeps", "mean", "max", "max |dE/E|");
+    for (Integrator integrator : { Integrator::VelocityVerlet, Integrator::PEFRL, Integrator::WisdomHolman }) {
+        for (bool adaptive : { false, true }) {
+            std::vector<CelestialBody> bodies = make_solar_system();
+            PhysicsWorldDouble world;
+            world.set_integrator(integrator);
+
+            SubstepController controller;
+            controller.set_order(integrator_order(integrator));
+            controller.set_tolerance(1e-8);
+
+            const double e0 = world.total_energy(bodies);
+            double max_drift = 0.0;
+            unsigned long long total = 0;
+            unsigned int most = 0;
+            for (unsigned int frame = 0; frame < FRAMES; frame++) {
+                unsigned int substeps = adaptive ? controller.substeps(FRAME_TIME) : 40;
+                for (unsigned int s = 0; s < substeps; s++)
+                    world.update_physics(bodies, FRAME_TIME / substeps);
+
+                double e = world.total_energy(bodies);
+                controller.update(e, world.total_angular_momentum(bodies), FRAME_TIME, substeps);
+                max_drift = std::max(max_drift, std::abs((e - e0) / e0));
+                total += substeps;
+                most = std::max(most, substeps);
+            }
+
+            std::printf("%-22s %10s %8.1f %8u %12.3e\n", integrator_name(integrator),
+                adaptive ? "adaptive" : "fixed", double(total) / FRAMES, most, max_drift);
+        }
+    }
+
+    // Direct-summation kernels on a disk of n bodies, all targets against all
+    // sources, each instruction set called directly
+    std::printf("\n%-22s %8s %14s %16s\n", "Gravity kernels", "n", "Mpairs/s", "max rel. diff");
+    const GravityKernels::Isa best = GravityKernels::detect_isa();
+    const float EPSILON = 1e-5f;   // as PhysicsWorld
+    for (size_t n : { 256u, 1024u, 4096u, 16384u }) {
+        std::vector<CelestialBody> bodies = make_disk(n);
+        std::vector<float> x(n), y(n), m(n);
+        for (size_t i = 0; i < n; i++) {
+            x[i] = bodies[i].get_position().x;
+            y[i] = bodies[i].get_position().y;
+            m[i] = bodies[i].get_mass();
+        }
+
+        // About 2e8 pair interactions per kernel
+        const size_t repeats = std::max<size_t>(1, 200000000 / (n * n));
+        std::vector<float> scalar_x(n), scalar_y(n), ax(n), ay(n);
+
+        using GravityKernels::Isa;
+        for (Isa isa : { Isa::Scalar, Isa::AVX2, Isa::AVX512 }) {
+            if (isa > best) continue;
+            float* out_x = isa == Isa::Scalar ? scalar_x.data() : ax.data();
+            float* out_y = isa == Isa::Scalar ? scalar_y.data() : ay.data();
+
+            auto start = std::chrono::steady_clock::now();
+            for (size_t r = 0; r < repeats; r++)
+                GravityKernels::direct_accelerations(isa, x.data(), y.data(), m.data(), n, 0, n,
+                    PhysicsConstants::G, EPSILON, out_x, out_y);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            // Relative to the scalar magnitude of each acceleration
+            double deviation = 0.0;
+            for (size_t i = 0; i < n; i++) {
+                double reference = std::hypot(double(scalar_x[i]), double(scalar_y[i]));
+                double difference = std::hypot(double(out_x[i]) - scalar_x[i], double(out_y[i]) - scalar_y[i]);
+                if (reference > 0.0)
+                    deviation = std::max(deviation, difference / reference);
+            }
+
+            std::printf("%-22s %8zu %14.1f %16.2e\n", GravityKernels::isa_name(isa), n,
+                double(n) * n * repeats / seconds * 1e-6, deviation);
+        }
+    }
+
+    // Steps reuse the buffers of the world: none of these should allocate
+    // (float state with 200 bodies runs the SIMD direct-summation kernels)
+    const unsigned int ALLOC_STEPS = 100;
+    std::printf("\n%-22s %10s %14s\n", "Allocations, n = 200", "pool", "per 100 steps");
+    for (Integrator integrator : { Integrator::VelocityVerlet, Integrator::PEFRL }) {
+        for (bool pooled : { false, true }) {
+            std::vector<CelestialBody> bodies = make_disk(200);
+            PhysicsWorld world;
+            world.set_integrator(integrator);
+            world.set_thread_pool(pooled ? &pool : nullptr);
+
+            std::printf("%-22s %10s %14llu\n", integrator_name(integrator), pooled ? "yes" : "no",
+                count_allocations(world, bodies, ALLOC_STEPS));
+        }
+    }
+    {
+        // The app's setup: Wisdom-Holman with collisions on
+        std::vector<CelestialBody> bodies = make_disk(200);
+        PhysicsWorld world;
+        world.set_integrator(Integrator::WisdomHolman);
+        world.set_collisions(true);
+        world.set_thread_pool(&pool);
+
+        std::printf("%-22s %10s %14llu\n", "W-H + collisions", "yes", count_allocations(world, bodies, ALLOC_STEPS));
+    }
+    {
+        // Levi-Civita pairs on a close binary
+        std::vector<CelestialBody> bodies = make_binary_cluster();
+        PhysicsWorld world;
+        world.set_integrator(Integrator::PEFRL);
+        world.set_regularization(true);
+
+        std::printf("%-22s %10s %14llu\n", "PEFRL + regularized", "no", count_allocations(world, bodies, ALLOC_STEPS));
+    }
+
+    return 0;
+}
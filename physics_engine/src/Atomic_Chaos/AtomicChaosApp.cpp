@@ -3,12 +3,19 @@
 #include <vector>
 #include <random>
 #include <iostream>
+#include <cmath>
+#include <algorithm>
 
 #include "Collision.h"
 #include "Particle.h"
 #include "AtomicChaosApp.h"
 
-AtomicChaosApp::AtomicChaosApp(): maxSize(800.f, 600.f), minSize(0.f, 0.f)
+AtomicChaosApp::AtomicChaosApp(const AtomicChaosConfig& config): maxSize(800.f, 600.f), minSize(0.f, 0.f),
+    storage(config.storage), compactParticles(maxSize, minSize),
+    pinWorkers(config.pinWorkers), hugePages(config.hugePages),
+    chargedParticles(config.chargedParticles), electrostatics(maxSize, minSize, 20000.0f),
+    bondedMolecules(config.bondedMolecules),
+    solver(config.solver), xpbd(maxSize, minSize)
 {
 }
 
@@ -30,6 +37,35 @@ void AtomicChaosApp::initialize()
     std::uniform_real_distribution<float> distX(50.0f, maxSize.x - 50.0f);
     std::uniform_real_distribution<float> distY(50.0f, maxSize.y - 50.0f);
 
+    if (storage == ParticleStorage::Compact)
+    {
+        if (chargedParticles || bondedMolecules)
+            std::cerr << "Compact storage has no charges or bonds: using contacts only.\n";
+
+        // Same distributions as Particle::Initialize
+        std::uniform_real_distribution<float> speedDist(100.0f, 300.0f);
+        std::uniform_real_distribution<float> angleDist(0.0f, 2.0f * 3.14159f);
+        std::uniform_real_distribution<float> spinDist(-5.0f, 5.0f);
+        std::uniform_int_distribution<int> colorDist(0, 5);
+
+        // Particle pages are first touched by the worker owning their strip
+        NumaMemory::setHugePages(hugePages);
+        workers = std::make_unique<ThreadPool>(0, pinWorkers);
+        compactParticles.setThreadPool(workers.get());
+
+        compactParticles.reserve(numParticles);
+        for (int i = 0; i < numParticles; i++)
+        {
+            float x = distX(gen);
+            float y = distY(gen);
+            float speed = speedDist(gen);
+            float angle = angleDist(gen);
+            compactParticles.addParticle({ x, y }, { speed * std::cos(angle), speed * std::sin(angle) },
+                spinDist(gen), static_cast<uint8_t>(colorDist(gen)));
+        }
+        return;
+    }
+
     particles.reserve(numParticles);
     for (size_t i = 0; i < numParticles; i++)
     {
@@ -38,7 +74,60 @@ void AtomicChaosApp::initialize()
         float m = 1.0f;
         particles.emplace_back(x, y, m);
         particles.back().Initialize();
+
+        if (chargedParticles)
+        {
+            // Neutral ionic mix: red cations, blue anions
+            float q = (i % 2 == 0) ? 1.0f : -1.0f;
+            particles.back().setCharge(q);
+            particles.back().shape.setFillColor(q > 0.0f ? sf::Color::Red : sf::Color::Blue);
+        }
+    }
+
+    if (bondedMolecules)
+        buildMolecules(gen);
+}
+
+// Lays consecutive particles out as straight chains and bonds them
+void AtomicChaosApp::buildMolecules(std::mt19937& gen)
+{
+    std::uniform_real_distribution<float> angleDist(0.0f, 2.0f * 3.14159f);
+    const float chainSpan = bondLength * (chainLength - 1);
+
+    for (size_t start = 0; start + chainLength <= particles.size(); start += chainLength)
+    {
+        // Head placed so the whole chain fits inside the box
+        float angle = angleDist(gen);
+        sf::Vector2f direction(std::cos(angle), std::sin(angle));
+        sf::Vector2f head = particles[start].Position;
+        head.x = std::clamp(head.x, 20.0f + std::max(0.0f, -direction.x * chainSpan), maxSize.x - 20.0f - std::max(0.0f, direction.x * chainSpan));
+        head.y = std::clamp(head.y, 20.0f + std::max(0.0f, -direction.y * chainSpan), maxSize.y - 20.0f - std::max(0.0f, direction.y * chainSpan));
+
+        for (int m = 0; m < chainLength; ++m)
+        {
+            Particle& bead = particles[start + m];
+            bead.Position = head + direction * (bondLength * m);
+            bead.Velocity = particles[start].Velocity;
+            bead.shape.setPosition(bead.Position);
+            bead.axis.setPosition(bead.Position);
+
+            uint32_t i = static_cast<uint32_t>(start + m);
+            if (m > 0) bonds.addDistanceConstraint(i - 1, i, bondLength);
+            if (m > 1) bonds.addAngleConstraint(i - 2, i - 1, i, 3.14159265f, 0.01f);
+        }
     }
+
+    workers = std::make_unique<ThreadPool>(0, pinWorkers);
+    bonds.setThreadPool(workers.get());
+    setSolver(solver);
+}
+
+void AtomicChaosApp::setSolver(CollisionSolver collisionSolver)
+{
+    solver = collisionSolver;
+
+    // XPBD converges through substeps rather than iterations
+    bonds.setIterations(solver == CollisionSolver::XPBD ? 1 : bondIterations);
 }
 
 void AtomicChaosApp::run()
@@ -53,6 +142,16 @@ void AtomicChaosApp::run()
             {
                 window.close();
             }
+
+            // X: impulse <-> XPBD contacts, for side-by-side comparisons
+            if (const auto* key = event->getIf<sf::Event::KeyPressed>())
+            {
+                if (key->code == sf::Keyboard::Key::X && storage == ParticleStorage::Standard)
+                {
+                    setSolver(solver == CollisionSolver::XPBD ? CollisionSolver::Impulse : CollisionSolver::XPBD);
+                    std::cout << "Collision solver: " << (solver == CollisionSolver::XPBD ? "XPBD" : "impulse") << "\n";
+                }
+            }
         }
         // Get delta time
         float dt = clock.restart().asSeconds();
@@ -61,24 +160,62 @@ void AtomicChaosApp::run()
         const float fixedDt = 1.0f / 60.0f;
         if (dt > 0.25f) dt = 0.25f;  // Prevent spiral of death
 
-        // Update particles (also checks for CCD with walls)
-        for (auto& p : particles) {
-            p.Update(fixedDt, maxSize, minSize);
+        if (storage == ParticleStorage::Compact)
+        {
+            // Fused quantized kernels (wall CCD + cell-list collisions)
+            compactParticles.Update(fixedDt);
+            compactParticles.resolveCollisions();
+
+            window.clear(sf::Color::Black);
+            compactParticles.Draw(window);
+            window.display();
+            continue;
         }
 
-        // Particle Collision Detection 
-        for (size_t i = 0; i < particles.size(); ++i) {
-            for (size_t j = i + 1; j < particles.size(); ++j) {
-                if (Collision::checkParticleCollision(particles[i], particles[j])) {
+        // Coulomb kick (PPPM: cell-list pairs + FFT mesh)
+        if (chargedParticles) {
+            chargePositions.resize(particles.size());
+            chargeValues.resize(particles.size());
+            for (size_t i = 0; i < particles.size(); ++i) {
+                chargePositions[i] = particles[i].Position;
+                chargeValues[i] = particles[i].getCharge();
+            }
+
+            electrostatics.computeForces(chargePositions, chargeValues, coulombForces);
+
+            for (size_t i = 0; i < particles.size(); ++i) {
+                particles[i].Velocity += coulombForces[i] * (fixedDt / particles[i].getMass());
+            }
+        }
+
+        if (solver == CollisionSolver::XPBD) {
+            // Substepped contacts, walls and bonds
+            xpbd.step(particles, bondedMolecules ? &bonds : nullptr, fixedDt);
+        }
+        else {
+            // Update particles (also checks for CCD with walls)
+            for (auto& p : particles) {
+                p.Update(fixedDt, maxSize, minSize);
+            }
+
+            // Bond projection (XPBD, parallel per constraint color)
+            bonds.solve(particles, fixedDt);
+
+            // Particle Collision Detection 
+            for (size_t i = 0; i < particles.size(); ++i) {
+                for (size_t j = i + 1; j < particles.size(); ++j) {
+                    if (Collision::checkParticleCollision(particles[i], particles[j])) {
 
-                    // Resolve collision
-                    Collision::resolveParticleCollision(particles[i], particles[j]);
+                        // Resolve collision
+                        Collision::resolveParticleCollision(particles[i], particles[j]);
+                    }
                 }
             }
         }
 
         // ----------------------- Render -----------------------
         window.clear(sf::Color::Black);
+        bonds.Draw(window, particles);
         for (auto& p : particles) {
             p.Draw(window);
         }
@@ -93,5 +230,10 @@ void AtomicChaosApp::cleanup()
     }
 
     particles.clear();
+    compactParticles.clear();
+    compactParticles.setThreadPool(nullptr);
+    bonds.clear();
+    bonds.setThreadPool(nullptr);
+    workers.reset();
     std::cout << "Resources released successfully! " << std::endl;
 }
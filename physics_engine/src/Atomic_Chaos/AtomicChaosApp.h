@@ -1,6 +1,42 @@
 #pragma once
 #include <SFML/Graphics.hpp>
+#include <memory>
+#include <random>
 #include "Particle.h"
+#include "CompactParticleState.h"
+#include "Electrostatics.h"
+#include "Bonds.h"
+#include "XPBDSolver.h"
+#include "../Common/ThreadPool.h"
+
+// How the particle state is stored. Charges and bonds need the standard
+// storage (either collision solver); compact storage only has contacts and
+// walls, and ignores chargedParticles and bondedMolecules.
+enum class ParticleStorage
+{
+	Standard,	// one Particle object (with its shapes) per particle
+	Compact		// quantized SoA state, see CompactParticleState
+};
+
+// How contacts are resolved (standard storage)
+enum class CollisionSolver
+{
+	Impulse,	// explicit update, then impulse + positional correction per pair
+	XPBD		// position-based substeps, one broadphase per frame
+};
+
+// Scene and solver of one app instance. The scene options apply at
+// initialize(); the solver can also be switched while running (X key).
+struct AtomicChaosConfig
+{
+	ParticleStorage storage = ParticleStorage::Standard;
+	CollisionSolver solver = CollisionSolver::Impulse;
+	bool chargedParticles = false;	// alternating +1/-1 Coulomb charges
+	bool bondedMolecules = false;	// chains of bonded beads
+	bool pinWorkers = true;			// pin pool workers by NUMA node
+	bool hugePages = true;			// huge pages for compact storage
+};
+
 class AtomicChaosApp
 {
 private:
@@ -10,11 +46,44 @@ private:
 	std::vector<Particle> particles;
 	const int numParticles = 500;
 	sf::RenderWindow window;
+
+	const ParticleStorage storage;
+	CompactParticleState compactParticles;
+
+	// Worker pool for compact storage strips and bond colors (pinned by NUMA node)
+	const bool pinWorkers;
+	const bool hugePages;
+	std::unique_ptr<ThreadPool> workers;
+
+	// Coulomb interactions (standard storage), alternating +1/-1 charges
+	const bool chargedParticles;
+	PPPMSolver electrostatics;
+	std::vector<sf::Vector2f> chargePositions;
+	std::vector<float> chargeValues;
+	std::vector<sf::Vector2f> coulombForces;
+
+	// Bonded molecules (standard storage): chains of beads with stiff bonds
+	// and semi-flexible bending
+	const bool bondedMolecules;
+	const int chainLength = 10;
+	const float bondLength = 12.0f;
+	const int bondIterations = 4;	// per frame with the impulse solver
+	BondSolver bonds;
+
+	CollisionSolver solver;
+	XPBDSolver xpbd;
 public:
-	AtomicChaosApp();
+	explicit AtomicChaosApp(const AtomicChaosConfig& config = {});
 	~AtomicChaosApp();
 
 	void initialize();
 	void run();
 	void cleanup();
+
+	// Standard storage only; takes effect from the next frame
+	void setSolver(CollisionSolver collisionSolver);
+	CollisionSolver getSolver() const { return solver; }
+
+private:
+	void buildMolecules(std::mt19937& gen);
 };
\ No newline at end of file
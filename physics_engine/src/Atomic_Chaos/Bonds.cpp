@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cmath>
+#include "Bonds.h"
+#include "../Common/ThreadPool.h"
+
+// -------------Building----------------
+void BondSolver::addDistanceConstraint(uint32_t a, uint32_t b, float restLength, float compliance)
+{
+    constraints.push_back({ { a, b, 0 }, 2, restLength, compliance, 0.0f });
+    colored = false;
+}
+
+void BondSolver::addAngleConstraint(uint32_t a, uint32_t b, uint32_t c, float restAngle, float compliance)
+{
+    constraints.push_back({ { a, b, c }, 3, restAngle, compliance, 0.0f });
+    colored = false;
+}
+
+void BondSolver::clear()
+{
+    constraints.clear();
+    colorStart.clear();
+    colored = true;
+}
+
+// Greedy coloring: each constraint takes the lowest color none of its
+// particles is already used in
+void BondSolver::buildColors(size_t particleCount)
+{
+    // Bit c % 64 of usedColors[p * words + c / 64] = particle p already has a
+    // constraint of color c; a word is added whenever every tracked color is
+    // taken, so high-degree particles never share a color
+    size_t words = 1;
+    std::vector<uint64_t> usedColors(particleCount, 0);
+    std::vector<uint32_t> colorOf(constraints.size(), 0);
+    uint32_t maxColor = 0;
+
+    for (size_t k = 0; k < constraints.size(); ++k)
+    {
+        const BondConstraint& c = constraints[k];
+
+        size_t word = 0;
+        uint64_t used = 0;
+        for (; word < words; ++word)
+        {
+            used = 0;
+            for (uint32_t n = 0; n < c.count; ++n)
+                used |= usedColors[c.particles[n] * words + word];
+            if (~used) break;
+        }
+
+        if (word == words)
+        {
+            std::vector<uint64_t> grown(particleCount * (words + 1), 0);
+            for (size_t p = 0; p < particleCount; ++p)
+                std::copy_n(usedColors.begin() + p * words, words, grown.begin() + p * (words + 1));
+            usedColors.swap(grown);
+            words++;
+            used = 0;
+        }
+
+        uint32_t bit = 0;
+        while (used & (uint64_t(1) << bit)) bit++;
+        const uint32_t color = static_cast<uint32_t>(word * 64) + bit;
+
+        colorOf[k] = color;
+        maxColor = std::max(maxColor, color);
+        for (uint32_t n = 0; n < c.count; ++n)
+            usedColors[c.particles[n] * words + word] |= uint64_t(1) << bit;
+    }
+
+    // Counting sort of the constraints by color
+    colorStart.assign(constraints.empty() ? 1 : maxColor + 2, 0);
+    for (uint32_t color : colorOf)
+        colorStart[color + 1]++;
+    for (size_t c = 1; c < colorStart.size(); ++c)
+        colorStart[c] += colorStart[c - 1];
+
+    std::vector<BondConstraint> sorted(constraints.size());
+    std::vector<size_t> cursor(colorStart.begin(), colorStart.end());
+    for (size_t k = 0; k < constraints.size(); ++k)
+        sorted[cursor[colorOf[k]]++] = constraints[k];
+
+    constraints.swap(sorted);
+    colored = true;
+}
+
+// -------------Solving----------------
+void BondSolver::solve(std::vector<Particle>& particles, float dt)
+{
+    if (constraints.empty() || dt <= 0.0f) return;
+
+    const size_t count = particles.size();
+    positions.resize(count);
+    startPositions.resize(count);
+    inverseMasses.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        positions[i] = particles[i].Position;
+        startPositions[i] = particles[i].Position;
+        inverseMasses[i] = 1.0f / particles[i].getMass();
+    }
+
+    resetMultipliers();
+    project(positions, inverseMasses, dt);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        sf::Vector2f correction = positions[i] - startPositions[i];
+        if (correction.x == 0.0f && correction.y == 0.0f) continue;
+
+        particles[i].Position = positions[i];
+        particles[i].Velocity += correction / dt;
+
+        // Sync visual shapes
+        particles[i].shape.setPosition(positions[i]);
+        particles[i].axis.setPosition(positions[i]);
+    }
+}
+
+void BondSolver::resetMultipliers()
+{
+    for (auto& constraint : constraints)
+        constraint.lambda = 0.0f;
+}
+
+void BondSolver::project(std::vector<sf::Vector2f>& positions, const std::vector<float>& inverseMasses, float dt)
+{
+    if (!colored) buildColors(positions.size());
+
+    for (int iteration = 0; iteration < iterations; ++iteration)
+    {
+        for (size_t color = 0; color + 1 < colorStart.size(); ++color)
+        {
+            const size_t begin = colorStart[color];
+            const size_t end = colorStart[color + 1];
+
+            auto projectRange = [&](size_t first, size_t last, unsigned int)
+            {
+                for (size_t k = first; k < last; ++k)
+                {
+                    BondConstraint& constraint = constraints[begin + k];
+                    projectConstraint(constraint, positions, inverseMasses, constraint.compliance / (dt * dt));
+                }
+            };
+
+            // Constraints of one color share no particle
+            if (pool && end - begin >= 256)
+                pool->parallelFor(end - begin, projectRange);
+            else
+                projectRange(0, end - begin, 0);
+        }
+    }
+}
+
+void BondSolver::projectConstraint(BondConstraint& constraint, std::vector<sf::Vector2f>& positions,
+    const std::vector<float>& inverseMasses, float alphaTilde)
+{
+    if (constraint.count == 2)
+    {
+        // C = |xa - xb| - L, gradient = +-n
+        uint32_t a = constraint.particles[0];
+        uint32_t b = constraint.particles[1];
+        float wa = inverseMasses[a];
+        float wb = inverseMasses[b];
+
+        sf::Vector2f d = positions[a] - positions[b];
+        float length = std::sqrt(d.x * d.x + d.y * d.y);
+        if (length < 1e-6f || wa + wb == 0.0f) return;
+
+        sf::Vector2f n = d / length;
+        float C = length - constraint.rest;
+        float deltaLambda = (-C - alphaTilde * constraint.lambda) / (wa + wb + alphaTilde);
+        constraint.lambda += deltaLambda;
+
+        positions[a] += n * (wa * deltaLambda);
+        positions[b] -= n * (wb * deltaLambda);
+        return;
+    }
+
+    // Angle at b between u = a - b and v = c - b: C = theta - theta0
+    uint32_t a = constraint.particles[0];
+    uint32_t b = constraint.particles[1];
+    uint32_t c = constraint.particles[2];
+
+    sf::Vector2f u = positions[a] - positions[b];
+    sf::Vector2f v = positions[c] - positions[b];
+    float uu = u.x * u.x + u.y * u.y;
+    float vv = v.x * v.x + v.y * v.y;
+    if (uu < 1e-12f || vv < 1e-12f) return;
+
+    const float pi = 3.14159265f;
+    float theta = std::atan2(u.x * v.y - u.y * v.x, u.x * v.x + u.y * v.y);
+    float C = theta - constraint.rest;
+    if (C > pi) C -= 2.0f * pi;
+    if (C < -pi) C += 2.0f * pi;
+
+    sf::Vector2f gradA(u.y / uu, -u.x / uu);
+    sf::Vector2f gradC(-v.y / vv, v.x / vv);
+    sf::Vector2f gradB = -(gradA + gradC);
+
+    float wa = inverseMasses[a], wb = inverseMasses[b], wc = inverseMasses[c];
+    float denominator = wa * (gradA.x * gradA.x + gradA.y * gradA.y)
+        + wb * (gradB.x * gradB.x + gradB.y * gradB.y)
+        + wc * (gradC.x * gradC.x + gradC.y * gradC.y)
+        + alphaTilde;
+    if (denominator < 1e-12f) return;
+
+    float deltaLambda = (-C - alphaTilde * constraint.lambda) / denominator;
+    constraint.lambda += deltaLambda;
+
+    positions[a] += gradA * (wa * deltaLambda);
+    positions[b] += gradB * (wb * deltaLambda);
+    positions[c] += gradC * (wc * deltaLambda);
+}
+
+// -----------------Drawing-------------------
+void BondSolver::Draw(sf::RenderWindow& window, const std::vector<Particle>& particles)
+{
+    lines.setPrimitiveType(sf::PrimitiveType::Lines);
+    lines.clear();
+
+    const sf::Color bondColor(200, 200, 200, 160);
+    for (const auto& constraint : constraints)
+    {
+        if (constraint.count != 2) continue;
+
+        sf::Vertex from;
+        from.position = particles[constraint.particles[0]].Position;
+        from.color = bondColor;
+        sf::Vertex to;
+        to.position = particles[constraint.particles[1]].Position;
+        to.color = bondColor;
+
+        lines.append(from);
+        lines.append(to);
+    }
+
+    window.draw(lines);
+}
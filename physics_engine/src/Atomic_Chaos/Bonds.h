@@ -0,0 +1,60 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "Particle.h"
+
+class ThreadPool;
+
+// Bond between two particles (distance) or three particles (angle at the middle one)
+struct BondConstraint
+{
+    uint32_t particles[3];
+    uint32_t count;         // 2 = distance, 3 = angle
+    float rest;             // rest length, or rest angle in radians
+    float compliance;       // inverse stiffness (0 = rigid)
+    float lambda;           // accumulated XPBD multiplier
+};
+
+// XPBD projection of bond constraints.
+// Constraints are greedily colored so that no two constraints of a color
+// share a particle; each color is then projected in parallel over the pool.
+class BondSolver
+{
+public:
+    void addDistanceConstraint(uint32_t a, uint32_t b, float restLength, float compliance = 0.0f);
+    void addAngleConstraint(uint32_t a, uint32_t b, uint32_t c, float restAngle, float compliance = 0.0f);
+    void clear();
+
+    void setThreadPool(ThreadPool* threadPool) { pool = threadPool; }
+    void setIterations(int count) { iterations = count; }
+
+    size_t size() const { return constraints.size(); }
+    size_t colorCount() const { return colorStart.empty() ? 0 : colorStart.size() - 1; }
+
+    // Projects positions after an explicit step of length dt and turns the
+    // correction into velocity (v += dx / dt)
+    void solve(std::vector<Particle>& particles, float dt);
+
+    // Same projection on raw state; substep solvers manage velocities themselves
+    void resetMultipliers();
+    void project(std::vector<sf::Vector2f>& positions, const std::vector<float>& inverseMasses, float dt);
+
+    void Draw(sf::RenderWindow& window, const std::vector<Particle>& particles);
+
+private:
+    std::vector<BondConstraint> constraints;   // sorted by color once colored
+    std::vector<size_t> colorStart;
+    bool colored = true;
+    int iterations = 4;
+    ThreadPool* pool = nullptr;
+
+    std::vector<sf::Vector2f> positions;
+    std::vector<sf::Vector2f> startPositions;
+    std::vector<float> inverseMasses;
+    sf::VertexArray lines;
+
+    void buildColors(size_t particleCount);
+    static void projectConstraint(BondConstraint& constraint, std::vector<sf::Vector2f>& positions,
+        const std::vector<float>& inverseMasses, float alphaTilde);
+};
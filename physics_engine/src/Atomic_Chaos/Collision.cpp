@@ -35,16 +35,25 @@ bool Collision::checkWallCollision(const sf::Vector2f& position, float radius, c
 //--------------- resolving Particle collisions ---------------
 void Collision::resolveParticleCollision(Particle& p1, Particle& p2)
 {
-    float r1 = p1.shape.getRadius();
-    float r2 = p2.shape.getRadius();
-    float dist = distance(p1.Position, p2.Position);
+    resolveParticleCollision(p1.Position, p1.Velocity, p1.getAngleV(), p1.getMass(), p1.shape.getRadius(),
+        p2.Position, p2.Velocity, p2.getAngleV(), p2.getMass(), p2.shape.getRadius());
+
+    // Sync visual shapes
+    p1.shape.setPosition(p1.Position);
+    p2.shape.setPosition(p2.Position);
+}
+
+void Collision::resolveParticleCollision(sf::Vector2f& pos1, sf::Vector2f& vel1, float& angleV1, float m1, float r1,
+    sf::Vector2f& pos2, sf::Vector2f& vel2, float& angleV2, float m2, float r2)
+{
+    float dist = distance(pos1, pos2);
     float radiusSum = r1 + r2;
 
     // Exit if not overlapping
     if (dist >= radiusSum) return;
 
     // Near-zero distance case
-    sf::Vector2f d = p1.Position - p2.Position;
+    sf::Vector2f d = pos1 - pos2;
     if (dist < 1e-6f) {
         d = sf::Vector2f(1.0f, 0.0f);
         dist = radiusSum;
@@ -55,7 +64,7 @@ void Collision::resolveParticleCollision(Particle& p1, Particle& p2)
     sf::Vector2f tangent(-normal.y, normal.x);
 
     // Relative velocity
-    sf::Vector2f v = p1.Velocity - p2.Velocity;
+    sf::Vector2f v = vel1 - vel2;
 
     // Normal velocity (approach speed)
     float v_n = dotProduct(v, normal);
@@ -65,23 +74,21 @@ void Collision::resolveParticleCollision(Particle& p1, Particle& p2)
 
     // --- PHASE 1: NORMAL IMPULSE (Bouncing) ---
 
-    float m1 = p1.getMass();
-    float m2 = p2.getMass();
     float restitution = 1.0f;  // Perfectly elastic
 
     // Normal impulse 
     float J_n = -(1.0f + restitution) * v_n / (1.0f / m1 + 1.0f / m2);
 
     // Apply normal impulse
-    p1.Velocity += (J_n / m1) * normal;
-    p2.Velocity -= (J_n / m2) * normal;
+    vel1 += (J_n / m1) * normal;
+    vel2 -= (J_n / m2) * normal;
 
     // --- PHASE 2: TANGENTIAL IMPULSE (Friction & Spin) ---
 
     // Tangential velocity (sliding speed at contact)
     float v_t = dotProduct(v, tangent)
-        + p1.getAngleV() * r1
-        - p2.getAngleV() * r2;
+        + angleV1 * r1
+        - angleV2 * r2;
 
     // Moment of inertia (solid circles)
     float I1 = 0.5f * m1 * r1 * r1;
@@ -99,12 +106,12 @@ void Collision::resolveParticleCollision(Particle& p1, Particle& p2)
      J_t = std::clamp(J_t, -mu * std::abs(J_n), mu * std::abs(J_n));
 
     // Apply tangential impulse to linear velocities
-    p1.Velocity += (J_t / m1) * tangent;
-    p2.Velocity -= (J_t / m2) * tangent;
+    vel1 += (J_t / m1) * tangent;
+    vel2 -= (J_t / m2) * tangent;
 
     // Apply tangential impulse to angular velocities
-    p1.getAngleV() += (r1 * J_t) / I1;
-    p2.getAngleV() -= (r2 * J_t) / I2;
+    angleV1 += (r1 * J_t) / I1;
+    angleV2 -= (r2 * J_t) / I2;
 
     // --- POSITIONAL CORRECTION (Prevent sinking) ---
 
@@ -113,52 +120,53 @@ void Collision::resolveParticleCollision(Particle& p1, Particle& p2)
     sf::Vector2f correction = normal * (overlap / 2.0f + epsilon);
 
     // Update positions
-    p1.Position += correction;
-    p2.Position -= correction;
-
-    // Sync visual shapes
-    p1.shape.setPosition(p1.Position);
-    p2.shape.setPosition(p2.Position);
+    pos1 += correction;
+    pos2 -= correction;
 }
 
 //--------------- resolving Wall collisions ---------------
 void Collision::resolveWallCollision(Particle& particle,float dt, const sf::Vector2f& maxSize, const sf::Vector2f& minSize)
 {
-    float radius = particle.shape.getRadius();
+    resolveWallCollision(particle.Position, particle.Velocity, particle.shape.getRadius(), dt, maxSize, minSize);
+
+    // Sync visual shape
+    particle.shape.setPosition(particle.Position);
+}
+
+void Collision::resolveWallCollision(sf::Vector2f& position, sf::Vector2f& velocity, float radius, float dt,
+    const sf::Vector2f& maxSize, const sf::Vector2f& minSize)
+{
     const float restitution = 1.0f; // perfectly elastic collision (no energy loss)
 
-    float tc = Collision::computeTOI(particle.Position, particle.Velocity, particle.shape.getRadius(), dt, maxSize, minSize);
+    float tc = Collision::computeTOI(position, velocity, radius, dt, maxSize, minSize);
     if (tc >= 0.0f && tc <= 1.0f)
     {
         // ---- Collision occurs within this frame ----
 
         // 1. Move up to the collision point
-        particle.Position += particle.Velocity * (tc * dt);
+        position += velocity * (tc * dt);
 
         // 2. Reflect velocity depending on which boundary was hit
-        if (particle.Position.x - radius <= minSize.x || particle.Position.x + radius >= maxSize.x)
-            particle.Velocity.x = -particle.Velocity.x * restitution;
+        if (position.x - radius <= minSize.x || position.x + radius >= maxSize.x)
+            velocity.x = -velocity.x * restitution;
 
-        if (particle.Position.y - radius <= minSize.y || particle.Position.y + radius >= maxSize.y)
-            particle.Velocity.y = -particle.Velocity.y * restitution;
+        if (position.y - radius <= minSize.y || position.y + radius >= maxSize.y)
+            velocity.y = -velocity.y * restitution;
 
         // 3. Move remaining time after the bounce
         float remaining = 1.0f - tc;
-        particle.Position += particle.Velocity * (remaining * dt);
+        position += velocity * (remaining * dt);
     }
     else
     {
         // ---- No collision this frame ----
-        particle.Position += particle.Velocity * dt;
+        position += velocity * dt;
     }
 
     // ----------------------- CORNER FIX -----------------------
     // Clamp particle inside the box after all movement
-    particle.Position.x = std::clamp(particle.Position.x, minSize.x + radius, maxSize.x - radius);
-    particle.Position.y = std::clamp(particle.Position.y, minSize.y + radius, maxSize.y - radius);
-
-    // Sync visual shape
-    particle.shape.setPosition(particle.Position);
+    position.x = std::clamp(position.x, minSize.x + radius, maxSize.x - radius);
+    position.y = std::clamp(position.y, minSize.y + radius, maxSize.y - radius);
 }
 
 // ---------- Calculating Compute Time Of Impact ----------
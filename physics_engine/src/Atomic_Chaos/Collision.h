@@ -17,6 +17,12 @@ public:
     static void resolveParticleCollision(Particle& p1, Particle& p2);
     static void resolveWallCollision(Particle& particle, float dt, const sf::Vector2f& maxSize, const sf::Vector2f& minSize);
 
+    // Same resolution on raw state, shared with storages that do not hold Particle objects
+    static void resolveParticleCollision(sf::Vector2f& pos1, sf::Vector2f& vel1, float& angleV1, float m1, float r1,
+        sf::Vector2f& pos2, sf::Vector2f& vel2, float& angleV2, float m2, float r2);
+    static void resolveWallCollision(sf::Vector2f& position, sf::Vector2f& velocity, float radius, float dt,
+        const sf::Vector2f& maxSize, const sf::Vector2f& minSize);
+
     // Time of impact calculation for CCD (contineous collision detection)
     static float computeTOI(const sf::Vector2f& position, const sf::Vector2f& velocity,
         float radius, float dt, const sf::Vector2f& maxSize,
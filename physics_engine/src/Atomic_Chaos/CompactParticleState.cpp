@@ -0,0 +1,652 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "CompactParticleState.h"
+#include "Collision.h"
+#include "../Common/ThreadPool.h"
+
+// -------------Constructor----------------
+CompactParticleState::CompactParticleState(const sf::Vector2f& maxSize, const sf::Vector2f& minSize, float radius, float mass)
+    : maxSize(maxSize), minSize(minSize), radius(radius), mass(mass)
+{
+    cellSize = 4.0f * radius;
+    cellsX = std::max(1u, static_cast<unsigned int>(std::ceil((maxSize.x - minSize.x) / cellSize)));
+    cellsY = std::max(1u, static_cast<unsigned int>(std::ceil((maxSize.y - minSize.y) / cellSize)));
+
+    offsetScale = (2.0f * cellSize) / 65536.0f;
+    offsetBias = -0.5f * cellSize;
+
+    // Two particles drifted towards each other from cells two apart are
+    // still 4r - 2 * driftMargin = 2r apart, so the 3x3 stencil stays exact
+    driftMargin = radius;
+
+    cellStart.assign(static_cast<size_t>(cellsX) * cellsY + 1, 0);
+    nextCellStart.assign(cellStart.size(), 0);
+
+    // Same look as Particle::Initialize
+    shape.setRadius(radius);
+    shape.setOrigin(sf::Vector2f(radius, radius));
+
+    axis.setSize(sf::Vector2f(radius, 1.0f));
+    axis.setOrigin(sf::Vector2f{ radius / 2.f, 0.5f });
+    axis.setFillColor(sf::Color::Black);
+}
+
+void CompactParticleState::reserve(size_t count)
+{
+    offsetX.reserve(count);  offsetY.reserve(count);
+    velX.reserve(count);     velY.reserve(count);
+    angleV.reserve(count);   rotation.reserve(count);
+    color.reserve(count);    newCell.reserve(count);
+}
+
+void CompactParticleState::clear()
+{
+    offsetX.clear();  offsetY.clear();
+    velX.clear();     velY.clear();
+    angleV.clear();   rotation.clear();
+    color.clear();    newCell.clear();
+
+    sortedOffsetX.clear();  sortedOffsetY.clear();
+    sortedVelX.clear();     sortedVelY.clear();
+    sortedAngleV.clear();   sortedRotation.clear();
+    sortedColor.clear();
+
+    std::fill(cellStart.begin(), cellStart.end(), 0);
+    binned = true;
+}
+
+void CompactParticleState::setThreadPool(ThreadPool* threadPool)
+{
+    pool = threadPool;
+}
+
+// Particles are appended unsorted and binned once everything is added
+void CompactParticleState::addParticle(const sf::Vector2f& position, const sf::Vector2f& velocity, float spin, uint8_t colorIndex)
+{
+    unsigned int cell = cellIndexOf(position);
+    sf::Vector2f local = position - cellOrigin(cell);
+
+    offsetX.push_back(encodeOffset(local.x));
+    offsetY.push_back(encodeOffset(local.y));
+    velX.push_back(floatToHalf(velocity.x));
+    velY.push_back(floatToHalf(velocity.y));
+    angleV.push_back(floatToHalf(spin));
+    rotation.push_back(floatToHalf(0.0f));
+    color.push_back(colorIndex);
+    newCell.push_back(cell);
+    binned = false;
+}
+
+// -------------Strip decomposition----------------
+unsigned int CompactParticleState::stripCount() const
+{
+    return pool ? std::min(pool->size(), cellsY) : 1u;
+}
+
+unsigned int CompactParticleState::stripRowBegin(unsigned int strip, unsigned int strips) const
+{
+    return static_cast<unsigned int>(static_cast<unsigned long long>(cellsY) * strip / strips);
+}
+
+// Strip s always runs on pool worker s
+template <typename Job>
+void CompactParticleState::forEachStrip(unsigned int strips, const Job& job)
+{
+    if (pool && strips > 1)
+    {
+        pool->runOnWorkers([&](unsigned int worker)
+        {
+            if (worker < strips) job(worker);
+        });
+    }
+    else
+    {
+        for (unsigned int strip = 0; strip < strips; ++strip)
+            job(strip);
+    }
+}
+
+// -------------Fused update kernel----------------
+// Two passes over the arrays:
+//  1. predict the cell of every particle after the step (positions and
+//     velocities only) and histogram the targets per strip
+//  2. integrate, and either write back in place when no particle left its
+//     cell (plus the drift margin) or scatter straight into the sorted copies
+// so a re-bin costs no separate copy of the state.
+void CompactParticleState::Update(float dt)
+{
+    if (!binned) rebin();
+
+    unsigned int strips = stripCount();
+    layoutStrips(strips);
+    stripMoved.assign(strips, 0);
+    stripEscaped.assign(strips, 0);
+
+    forEachStrip(strips, [&](unsigned int strip)
+    {
+        predictCells(strip, strips, dt, stripMoved[strip], stripEscaped[strip]);
+    });
+
+    if (std::find(stripMoved.begin(), stripMoved.end(), 1) == stripMoved.end())
+    {
+        forEachStrip(strips, [&](unsigned int strip)
+        {
+            updateCells(stripRowBegin(strip, strips) * cellsX, stripRowBegin(strip + 1, strips) * cellsX, dt);
+        });
+        return;
+    }
+
+    // A particle jumped past the neighbouring rows: count on one strip
+    if (std::find(stripEscaped.begin(), stripEscaped.end(), 1) != stripEscaped.end())
+    {
+        strips = 1;
+        countStrips(strips);
+    }
+    prefixSum(strips);
+
+    forEachStrip(strips, [&](unsigned int strip)
+    {
+        scatterCells(strip, strips, dt);
+    });
+
+    offsetX.swap(sortedOffsetX);  offsetY.swap(sortedOffsetY);
+    velX.swap(sortedVelX);        velY.swap(sortedVelY);
+    angleV.swap(sortedAngleV);    rotation.swap(sortedRotation);
+    color.swap(sortedColor);
+    cellStart.swap(nextCellStart);
+}
+
+// Wall CCD and position integration, same as Particle::Update
+void CompactParticleState::stepMotion(unsigned int cell, size_t i, float dt, sf::Vector2f& position, sf::Vector2f& velocity) const
+{
+    position = decodePosition(cell, i);
+    velocity = sf::Vector2f(halfToFloat(velX[i]), halfToFloat(velY[i]));
+    Collision::resolveWallCollision(position, velocity, radius, dt, maxSize, minSize);
+}
+
+void CompactParticleState::stepSpin(size_t i, float dt, float& spin, float& angle) const
+{
+    const float twoPi = 2.0f * 3.14159265f;
+
+    spin = halfToFloat(angleV[i]);
+    angle = std::remainder(halfToFloat(rotation[i]) + spin * dt, twoPi);
+    spin *= 0.99f;
+}
+
+// The current cell while the particle stays within the drift margin of it
+unsigned int CompactParticleState::driftCell(unsigned int cell, const sf::Vector2f& position) const
+{
+    sf::Vector2f local = position - cellOrigin(cell);
+    if (local.x >= -driftMargin && local.x < cellSize + driftMargin &&
+        local.y >= -driftMargin && local.y < cellSize + driftMargin)
+        return cell;
+    return cellIndexOf(position);
+}
+
+void CompactParticleState::predictCells(unsigned int strip, unsigned int strips, float dt, uint8_t& moved, uint8_t& escaped)
+{
+    uint32_t* counts = stripCounts.data() + windowBase[strip];
+    const unsigned int firstCell = windowRowBegin[strip] * cellsX;
+    const unsigned int lastCell = windowRowEnd[strip] * cellsX;
+    const unsigned int cellBegin = stripRowBegin(strip, strips) * cellsX;
+    const unsigned int cellEnd = stripRowBegin(strip + 1, strips) * cellsX;
+
+    for (unsigned int cell = cellBegin; cell < cellEnd; ++cell)
+    {
+        for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i)
+        {
+            sf::Vector2f position, velocity;
+            stepMotion(cell, i, dt, position, velocity);
+
+            unsigned int target = driftCell(cell, position);
+            newCell[i] = target;
+            if (target != cell) moved = 1;
+
+            if (target < firstCell || target >= lastCell)
+                escaped = 1;
+            else
+                counts[target - firstCell]++;
+        }
+    }
+}
+
+// In place: every particle stays in its cell
+void CompactParticleState::updateCells(unsigned int cellBegin, unsigned int cellEnd, float dt)
+{
+    for (unsigned int cell = cellBegin; cell < cellEnd; ++cell)
+    {
+        for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i)
+        {
+            sf::Vector2f position, velocity;
+            float spin, angle;
+            stepMotion(cell, i, dt, position, velocity);
+            stepSpin(i, dt, spin, angle);
+
+            encodePosition(cell, i, position);
+            velX[i] = floatToHalf(velocity.x);
+            velY[i] = floatToHalf(velocity.y);
+            angleV[i] = floatToHalf(spin);
+            rotation[i] = floatToHalf(angle);
+        }
+    }
+}
+
+// Integrate and encode into the sorted copies, relative to the predicted cell
+void CompactParticleState::scatterCells(unsigned int strip, unsigned int strips, float dt)
+{
+    uint32_t* counts = stripCounts.data() + windowBase[strip];
+    const unsigned int firstCell = windowRowBegin[strip] * cellsX;
+    const unsigned int cellBegin = stripRowBegin(strip, strips) * cellsX;
+    const unsigned int cellEnd = stripRowBegin(strip + 1, strips) * cellsX;
+
+    for (unsigned int cell = cellBegin; cell < cellEnd; ++cell)
+    {
+        for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i)
+        {
+            sf::Vector2f position, velocity;
+            float spin, angle;
+            stepMotion(cell, i, dt, position, velocity);
+            stepSpin(i, dt, spin, angle);
+
+            const unsigned int target = newCell[i];
+            const uint32_t dst = counts[target - firstCell]++;
+            sf::Vector2f local = position - cellOrigin(target);
+            sortedOffsetX[dst] = encodeOffset(local.x);
+            sortedOffsetY[dst] = encodeOffset(local.y);
+            sortedVelX[dst] = floatToHalf(velocity.x);
+            sortedVelY[dst] = floatToHalf(velocity.y);
+            sortedAngleV[dst] = floatToHalf(spin);
+            sortedRotation[dst] = floatToHalf(angle);
+            sortedColor[dst] = color[i];
+        }
+    }
+}
+
+// -------------Cell-list collision kernel----------------
+void CompactParticleState::resolveCollisions()
+{
+    if (!binned) rebin();
+
+    const unsigned int strips = stripCount();
+    if (strips == 1)
+    {
+        collideRows(0, cellsY);
+        return;
+    }
+
+    // The half stencil writes into the first row of the next strip, so even
+    // and odd strips take turns
+    for (unsigned int parity = 0; parity < 2; ++parity)
+    {
+        forEachStrip(strips, [&](unsigned int strip)
+        {
+            if (strip % 2 == parity)
+                collideRows(stripRowBegin(strip, strips), stripRowBegin(strip + 1, strips));
+        });
+    }
+}
+
+void CompactParticleState::collideRows(unsigned int rowBegin, unsigned int rowEnd)
+{
+    const float radiusSum = 2.0f * radius;
+
+    // Half stencil: every neighbouring cell pair is visited once
+    const int neighbourX[4] = { 1, -1, 0, 1 };
+    const int neighbourY[4] = { 0, 1, 1, 1 };
+
+    for (unsigned int cy = rowBegin; cy < rowEnd; ++cy)
+    {
+        for (unsigned int cx = 0; cx < cellsX; ++cx)
+        {
+            unsigned int cell = cy * cellsX + cx;
+
+            for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i)
+            {
+                sf::Vector2f pos1 = decodePosition(cell, i);
+                sf::Vector2f vel1(halfToFloat(velX[i]), halfToFloat(velY[i]));
+                float spin1 = halfToFloat(angleV[i]);
+                bool touched = false;
+
+                auto visit = [&](unsigned int otherCell, uint32_t j)
+                {
+                    sf::Vector2f pos2 = decodePosition(otherCell, j);
+                    sf::Vector2f d = pos2 - pos1;
+                    if (d.x * d.x + d.y * d.y > radiusSum * radiusSum) return;
+
+                    sf::Vector2f vel2(halfToFloat(velX[j]), halfToFloat(velY[j]));
+                    float spin2 = halfToFloat(angleV[j]);
+
+                    Collision::resolveParticleCollision(pos1, vel1, spin1, mass, radius, pos2, vel2, spin2, mass, radius);
+
+                    encodePosition(otherCell, j, pos2);
+                    velX[j] = floatToHalf(vel2.x);
+                    velY[j] = floatToHalf(vel2.y);
+                    angleV[j] = floatToHalf(spin2);
+                    touched = true;
+                };
+
+                for (uint32_t j = i + 1; j < cellStart[cell + 1]; ++j)
+                    visit(cell, j);
+
+                for (int n = 0; n < 4; ++n)
+                {
+                    int nx = static_cast<int>(cx) + neighbourX[n];
+                    int ny = static_cast<int>(cy) + neighbourY[n];
+                    if (nx < 0 || nx >= static_cast<int>(cellsX) || ny >= static_cast<int>(cellsY)) continue;
+
+                    unsigned int otherCell = static_cast<unsigned int>(ny) * cellsX + static_cast<unsigned int>(nx);
+                    for (uint32_t j = cellStart[otherCell]; j < cellStart[otherCell + 1]; ++j)
+                        visit(otherCell, j);
+                }
+
+                if (touched)
+                {
+                    encodePosition(cell, i, pos1);
+                    velX[i] = floatToHalf(vel1.x);
+                    velY[i] = floatToHalf(vel1.y);
+                    angleV[i] = floatToHalf(spin1);
+                }
+            }
+        }
+    }
+}
+
+// -----------------Drawing-------------------
+void CompactParticleState::Draw(sf::RenderWindow& window)
+{
+    static const sf::Color colors[] = { sf::Color::Red, sf::Color::Green, sf::Color::Blue,
+                                        sf::Color::Yellow, sf::Color::Magenta, sf::Color::Cyan };
+    const unsigned int numCells = cellsX * cellsY;
+    if (!binned) rebin();
+
+    for (unsigned int cell = 0; cell < numCells; ++cell)
+    {
+        for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i)
+        {
+            sf::Vector2f position = decodePosition(cell, i);
+            sf::Angle angle = sf::radians(halfToFloat(rotation[i]));
+
+            shape.setFillColor(colors[color[i] % 6]);
+            shape.setPosition(position);
+            shape.setRotation(angle);
+            axis.setPosition(position);
+            axis.setRotation(angle);
+
+            window.draw(shape);
+            window.draw(axis);
+        }
+    }
+}
+
+// -------------Accessors----------------
+sf::Vector2f CompactParticleState::getPosition(size_t i) const
+{
+    if (!binned) return decodePosition(newCell[i], i);
+
+    // Last cell starting at or before i
+    auto next = std::upper_bound(cellStart.begin(), cellStart.end(), static_cast<uint32_t>(i));
+    return decodePosition(static_cast<unsigned int>(next - cellStart.begin() - 1), i);
+}
+
+sf::Vector2f CompactParticleState::getVelocity(size_t i) const
+{
+    return sf::Vector2f(halfToFloat(velX[i]), halfToFloat(velY[i]));
+}
+
+// -------------Grid helpers----------------
+unsigned int CompactParticleState::cellIndexOf(const sf::Vector2f& position) const
+{
+    int cx = static_cast<int>((position.x - minSize.x) / cellSize);
+    int cy = static_cast<int>((position.y - minSize.y) / cellSize);
+    cx = std::clamp(cx, 0, static_cast<int>(cellsX) - 1);
+    cy = std::clamp(cy, 0, static_cast<int>(cellsY) - 1);
+    return static_cast<unsigned int>(cy) * cellsX + static_cast<unsigned int>(cx);
+}
+
+sf::Vector2f CompactParticleState::cellOrigin(unsigned int cell) const
+{
+    return sf::Vector2f(minSize.x + (cell % cellsX) * cellSize, minSize.y + (cell / cellsX) * cellSize);
+}
+
+sf::Vector2f CompactParticleState::decodePosition(unsigned int cell, size_t i) const
+{
+    sf::Vector2f origin = cellOrigin(cell);
+    return sf::Vector2f(origin.x + offsetX[i] * offsetScale + offsetBias,
+                        origin.y + offsetY[i] * offsetScale + offsetBias);
+}
+
+void CompactParticleState::encodePosition(unsigned int cell, size_t i, const sf::Vector2f& position)
+{
+    sf::Vector2f local = position - cellOrigin(cell);
+    offsetX[i] = encodeOffset(local.x);
+    offsetY[i] = encodeOffset(local.y);
+}
+
+uint16_t CompactParticleState::encodeOffset(float local) const
+{
+    float q = std::round((local - offsetBias) / offsetScale);
+    if (q < 0.0f || q > 65535.0f)
+    {
+        clampedOffsets.fetch_add(1, std::memory_order_relaxed);
+        q = std::clamp(q, 0.0f, 65535.0f);
+    }
+    return static_cast<uint16_t>(q);
+}
+
+// Counting sort of freshly added particles by newCell (they can be anywhere,
+// so on one strip), rebuilding cellStart. Moving particles are re-binned by
+// Update while it integrates them.
+void CompactParticleState::rebin()
+{
+    const size_t count = size();
+
+    countStrips(1);
+    prefixSum(1);
+    cellStart.swap(nextCellStart);
+
+    // New particles were written by the caller's thread: give the sorted
+    // copies fresh pages that the owning workers touch first
+    allocateScratch();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t dst = stripCounts[newCell[i]]++;
+        sortedOffsetX[dst] = offsetX[i];
+        sortedOffsetY[dst] = offsetY[i];
+        sortedVelX[dst] = velX[i];
+        sortedVelY[dst] = velY[i];
+        sortedAngleV[dst] = angleV[i];
+        sortedRotation[dst] = rotation[i];
+        sortedColor[dst] = color[i];
+    }
+
+    offsetX.swap(sortedOffsetX);  offsetY.swap(sortedOffsetY);
+    velX.swap(sortedVelX);        velY.swap(sortedVelY);
+    angleV.swap(sortedAngleV);    rotation.swap(sortedRotation);
+    color.swap(sortedColor);
+
+    // Fresh pages again for the scratch copies and the target cells, first
+    // written by the prediction pass of the owners
+    allocateScratch();
+    NumaVector<uint32_t> fresh;
+    fresh.resize(count);
+    newCell.swap(fresh);
+
+    binned = true;
+}
+
+// Strip slices of the sorted order and their histogram windows of cell rows
+// (strip rows +-1: a particle only moves into a neighbouring row per step)
+void CompactParticleState::layoutStrips(unsigned int strips)
+{
+    sliceBegin.resize(strips + 1);
+    windowRowBegin.resize(strips);
+    windowRowEnd.resize(strips);
+    windowBase.resize(strips + 1);
+
+    windowBase[0] = 0;
+    for (unsigned int s = 0; s < strips; ++s)
+    {
+        unsigned int rowBegin = stripRowBegin(s, strips);
+        unsigned int rowEnd = stripRowBegin(s + 1, strips);
+
+        sliceBegin[s] = strips == 1 ? 0 : cellStart[rowBegin * cellsX];
+        windowRowBegin[s] = strips == 1 ? 0 : (rowBegin > 0 ? rowBegin - 1 : 0);
+        windowRowEnd[s] = strips == 1 ? cellsY : std::min(rowEnd + 1, cellsY);
+        windowBase[s + 1] = windowBase[s] + static_cast<size_t>(windowRowEnd[s] - windowRowBegin[s]) * cellsX;
+    }
+    sliceBegin[strips] = size();
+
+    stripCounts.assign(windowBase[strips], 0);
+}
+
+// Histogram of newCell over every strip slice; false if a particle left its
+// strip window
+bool CompactParticleState::countStrips(unsigned int strips)
+{
+    layoutStrips(strips);
+    stripEscaped.assign(strips, 0);
+
+    forEachStrip(strips, [&](unsigned int strip)
+    {
+        uint32_t* counts = stripCounts.data() + windowBase[strip];
+        const unsigned int firstCell = windowRowBegin[strip] * cellsX;
+        const unsigned int lastCell = windowRowEnd[strip] * cellsX;
+
+        for (size_t i = sliceBegin[strip]; i < sliceBegin[strip + 1]; ++i)
+        {
+            uint32_t cell = newCell[i];
+            if (cell < firstCell || cell >= lastCell)
+            {
+                stripEscaped[strip] = 1;
+                return;
+            }
+            counts[cell - firstCell]++;
+        }
+    });
+
+    return std::find(stripEscaped.begin(), stripEscaped.end(), 1) == stripEscaped.end();
+}
+
+// Turn the strip histograms into scatter cursors and nextCellStart.
+// The global prefix sum runs in (cell, strip) order, which keeps the sort
+// stable.
+void CompactParticleState::prefixSum(unsigned int strips)
+{
+    const unsigned int numCells = cellsX * cellsY;
+
+    uint32_t running = 0;
+    unsigned int firstStrip = 0;
+    for (unsigned int row = 0; row < cellsY; ++row)
+    {
+        while (windowRowEnd[firstStrip] <= row) firstStrip++;
+
+        for (unsigned int cell = row * cellsX; cell < (row + 1) * cellsX; ++cell)
+        {
+            nextCellStart[cell] = running;
+            for (unsigned int s = firstStrip; s < strips && windowRowBegin[s] <= row; ++s)
+            {
+                uint32_t& slot = stripCounts[windowBase[s] + cell - windowRowBegin[s] * cellsX];
+                uint32_t n = slot;
+                slot = running;
+                running += n;
+            }
+        }
+    }
+    nextCellStart[numCells] = running;
+}
+
+// Replace the sorted copies with untouched pages and let every strip
+// owner write its own range first (cellStart must be up to date)
+void CompactParticleState::allocateScratch()
+{
+    const size_t count = size();
+
+    NumaVector<uint16_t>().swap(sortedOffsetX);  sortedOffsetX.resize(count);
+    NumaVector<uint16_t>().swap(sortedOffsetY);  sortedOffsetY.resize(count);
+    NumaVector<uint16_t>().swap(sortedVelX);     sortedVelX.resize(count);
+    NumaVector<uint16_t>().swap(sortedVelY);     sortedVelY.resize(count);
+    NumaVector<uint16_t>().swap(sortedAngleV);   sortedAngleV.resize(count);
+    NumaVector<uint16_t>().swap(sortedRotation); sortedRotation.resize(count);
+    NumaVector<uint8_t>().swap(sortedColor);     sortedColor.resize(count);
+
+    const unsigned int owners = stripCount();
+    forEachStrip(owners, [&](unsigned int strip)
+    {
+        size_t begin = cellStart[stripRowBegin(strip, owners) * cellsX];
+        size_t end = cellStart[stripRowBegin(strip + 1, owners) * cellsX];
+        std::fill(sortedOffsetX.begin() + begin, sortedOffsetX.begin() + end, 0);
+        std::fill(sortedOffsetY.begin() + begin, sortedOffsetY.begin() + end, 0);
+        std::fill(sortedVelX.begin() + begin, sortedVelX.begin() + end, 0);
+        std::fill(sortedVelY.begin() + begin, sortedVelY.begin() + end, 0);
+        std::fill(sortedAngleV.begin() + begin, sortedAngleV.begin() + end, 0);
+        std::fill(sortedRotation.begin() + begin, sortedRotation.begin() + end, 0);
+        std::fill(sortedColor.begin() + begin, sortedColor.begin() + end, 0);
+    });
+}
+
+// -------------Half precision conversion----------------
+uint16_t CompactParticleState::floatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t mantissa = bits & 0x007fffffu;
+    int exponent = static_cast<int>((bits >> 23) & 0xffu) - 127 + 15;
+
+    // Inf / NaN
+    if ((bits & 0x7fffffffu) >= 0x7f800000u)
+        return static_cast<uint16_t>(sign | 0x7c00u | (mantissa ? 0x0200u : 0u));
+
+    // Overflow to infinity
+    if (exponent >= 31)
+        return static_cast<uint16_t>(sign | 0x7c00u);
+
+    // Subnormal or zero
+    if (exponent <= 0)
+    {
+        if (exponent < -10) return static_cast<uint16_t>(sign);
+
+        mantissa |= 0x00800000u;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1u);
+        uint32_t midpoint = 1u << (shift - 1u);
+        if (remainder > midpoint || (remainder == midpoint && (half & 1u))) half++;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1fffu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) half++;  // carry may round up to inf
+    return static_cast<uint16_t>(sign | half);
+}
+
+float CompactParticleState::halfToFloat(uint16_t value)
+{
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x03ffu;
+    uint32_t bits;
+
+    if (exponent == 0)
+    {
+        // Zero or subnormal: mantissa * 2^-24
+        float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+    else if (exponent == 31)
+    {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cmath>
+#include "Electrostatics.h"
+
+namespace
+{
+    const float TWO_OVER_SQRT_PI = 1.12837917f;
+}
+
+// -------------Constructor----------------
+PPPMSolver::PPPMSolver(const sf::Vector2f& maxSize, const sf::Vector2f& minSize,
+    float coulombConstant, float cutoff, float meshSpacing)
+    : maxSize(maxSize), minSize(minSize), coulombConstant(coulombConstant),
+    cutoff(cutoff), alpha(3.5f / cutoff), meshSpacing(meshSpacing)
+{
+    // Nodes covering the box plus one for the right CIC neighbour
+    meshX = static_cast<size_t>(std::ceil((maxSize.x - minSize.x) / meshSpacing)) + 2;
+    meshY = static_cast<size_t>(std::ceil((maxSize.y - minSize.y) / meshSpacing)) + 2;
+
+    // Zero padding to twice the mesh keeps the convolution non-periodic
+    fft = FFT2D(FFT2D::nextPowerOfTwo(2 * meshX), FFT2D::nextPowerOfTwo(2 * meshY));
+
+    cellsX = std::max(1u, static_cast<unsigned int>(std::ceil((maxSize.x - minSize.x) / cutoff)));
+    cellsY = std::max(1u, static_cast<unsigned int>(std::ceil((maxSize.y - minSize.y) / cutoff)));
+    cellStart.resize(static_cast<size_t>(cellsX) * cellsY + 1);
+
+    buildKernel();
+}
+
+// Field of a unit Gaussian-smeared charge, sampled at every mesh offset
+void PPPMSolver::buildKernel()
+{
+    const size_t width = fft.getWidth();
+    const size_t height = fft.getHeight();
+
+    kernelX.assign(width * height, 0.0f);
+    kernelY.assign(width * height, 0.0f);
+
+    for (size_t y = 0; y < height; ++y)
+    {
+        // Offsets wrap around: index n/2.. are negative offsets
+        float dy = (y < height / 2 ? static_cast<float>(y) : static_cast<float>(y) - height) * meshSpacing;
+
+        for (size_t x = 0; x < width; ++x)
+        {
+            float dx = (x < width / 2 ? static_cast<float>(x) : static_cast<float>(x) - width) * meshSpacing;
+            float r = std::sqrt(dx * dx + dy * dy);
+            if (r == 0.0f) continue;
+
+            // g(r) = (erf(a r) - 2 a r / sqrt(pi) exp(-a^2 r^2)) / r^2, smooth with g(0) = 0
+            float ar = alpha * r;
+            float g = (std::erf(ar) - TWO_OVER_SQRT_PI * ar * std::exp(-ar * ar)) / (r * r);
+
+            kernelX[y * width + x] = g * dx / r;
+            kernelY[y * width + x] = g * dy / r;
+        }
+    }
+
+    fft.forward(kernelX);
+    fft.forward(kernelY);
+}
+
+// -------------Forces----------------
+void PPPMSolver::computeForces(const std::vector<sf::Vector2f>& positions, const std::vector<float>& charges,
+    std::vector<sf::Vector2f>& forces)
+{
+    forces.assign(positions.size(), sf::Vector2f(0.f, 0.f));
+    if (positions.empty()) return;
+
+    shortRange(positions, charges, forces);
+    longRange(positions, charges, forces);
+}
+
+void PPPMSolver::shortRange(const std::vector<sf::Vector2f>& positions, const std::vector<float>& charges,
+    std::vector<sf::Vector2f>& forces)
+{
+    const size_t count = positions.size();
+    const unsigned int numCells = cellsX * cellsY;
+
+    auto cellOf = [&](const sf::Vector2f& p)
+    {
+        int cx = std::clamp(static_cast<int>((p.x - minSize.x) / cutoff), 0, static_cast<int>(cellsX) - 1);
+        int cy = std::clamp(static_cast<int>((p.y - minSize.y) / cutoff), 0, static_cast<int>(cellsY) - 1);
+        return static_cast<unsigned int>(cy) * cellsX + static_cast<unsigned int>(cx);
+    };
+
+    // Counting sort of particle indices by cell
+    std::fill(cellStart.begin(), cellStart.end(), 0);
+    for (size_t i = 0; i < count; ++i)
+        cellStart[cellOf(positions[i]) + 1]++;
+    for (unsigned int c = 0; c < numCells; ++c)
+        cellStart[c + 1] += cellStart[c];
+
+    cellParticles.resize(count);
+    cellCursor.assign(cellStart.begin(), cellStart.end() - 1);
+    for (size_t i = 0; i < count; ++i)
+        cellParticles[cellCursor[cellOf(positions[i])]++] = static_cast<uint32_t>(i);
+
+    const float cutoff2 = cutoff * cutoff;
+    auto pair = [&](uint32_t i, uint32_t j)
+    {
+        sf::Vector2f d = positions[i] - positions[j];
+        float r2 = d.x * d.x + d.y * d.y;
+        if (r2 >= cutoff2 || r2 < 1e-8f) return;
+
+        // Screened part: (erfc(a r) + 2 a r / sqrt(pi) exp(-a^2 r^2)) / r^2
+        float r = std::sqrt(r2);
+        float ar = alpha * r;
+        float g = (std::erfc(ar) + TWO_OVER_SQRT_PI * ar * std::exp(-ar * ar)) / r2;
+
+        sf::Vector2f f = d * (coulombConstant * charges[i] * charges[j] * g / r);
+        forces[i] += f;
+        forces[j] -= f;
+    };
+
+    // Half stencil over neighbouring cells
+    const int neighbourX[4] = { 1, -1, 0, 1 };
+    const int neighbourY[4] = { 0, 1, 1, 1 };
+
+    for (unsigned int cy = 0; cy < cellsY; ++cy)
+    {
+        for (unsigned int cx = 0; cx < cellsX; ++cx)
+        {
+            unsigned int cell = cy * cellsX + cx;
+            for (uint32_t a = cellStart[cell]; a < cellStart[cell + 1]; ++a)
+            {
+                uint32_t i = cellParticles[a];
+                if (charges[i] == 0.0f) continue;
+
+                for (uint32_t b = a + 1; b < cellStart[cell + 1]; ++b)
+                    pair(i, cellParticles[b]);
+
+                for (int n = 0; n < 4; ++n)
+                {
+                    int nx = static_cast<int>(cx) + neighbourX[n];
+                    int ny = static_cast<int>(cy) + neighbourY[n];
+                    if (nx < 0 || nx >= static_cast<int>(cellsX) || ny >= static_cast<int>(cellsY)) continue;
+
+                    unsigned int other = static_cast<unsigned int>(ny) * cellsX + static_cast<unsigned int>(nx);
+                    for (uint32_t b = cellStart[other]; b < cellStart[other + 1]; ++b)
+                        pair(i, cellParticles[b]);
+                }
+            }
+        }
+    }
+}
+
+void PPPMSolver::longRange(const std::vector<sf::Vector2f>& positions, const std::vector<float>& charges,
+    std::vector<sf::Vector2f>& forces)
+{
+    const size_t width = fft.getWidth();
+    size_t ix, iy;
+    float fx, fy;
+
+    // 1) Cloud-in-cell charge assignment
+    density.assign(width * fft.getHeight(), 0.0f);
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        if (charges[i] == 0.0f) continue;
+        meshWeights(positions[i], ix, iy, fx, fy);
+
+        float q = charges[i];
+        size_t node = iy * width + ix;
+        density[node] += q * (1.f - fx) * (1.f - fy);
+        density[node + 1] += q * fx * (1.f - fy);
+        density[node + width] += q * (1.f - fx) * fy;
+        density[node + width + 1] += q * fx * fy;
+    }
+
+    // 2) Convolution with the field kernel in Fourier space
+    fft.forward(density);
+    fieldX.resize(density.size());
+    fieldY.resize(density.size());
+    for (size_t k = 0; k < density.size(); ++k)
+    {
+        fieldX[k] = density[k] * kernelX[k];
+        fieldY[k] = density[k] * kernelY[k];
+    }
+    fft.inverse(fieldX);
+    fft.inverse(fieldY);
+
+    // 3) Interpolate the field back with the same weights
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        if (charges[i] == 0.0f) continue;
+        meshWeights(positions[i], ix, iy, fx, fy);
+
+        size_t node = iy * width + ix;
+        float w00 = (1.f - fx) * (1.f - fy), w10 = fx * (1.f - fy);
+        float w01 = (1.f - fx) * fy, w11 = fx * fy;
+
+        sf::Vector2f field(
+            w00 * fieldX[node].real() + w10 * fieldX[node + 1].real() + w01 * fieldX[node + width].real() + w11 * fieldX[node + width + 1].real(),
+            w00 * fieldY[node].real() + w10 * fieldY[node + 1].real() + w01 * fieldY[node + width].real() + w11 * fieldY[node + width + 1].real());
+
+        forces[i] += field * (coulombConstant * charges[i]);
+    }
+}
+
+void PPPMSolver::meshWeights(const sf::Vector2f& position, size_t& ix, size_t& iy, float& fx, float& fy) const
+{
+    float gx = std::clamp((position.x - minSize.x) / meshSpacing, 0.0f, static_cast<float>(meshX - 2));
+    float gy = std::clamp((position.y - minSize.y) / meshSpacing, 0.0f, static_cast<float>(meshY - 2));
+
+    ix = std::min(static_cast<size_t>(gx), meshX - 2);
+    iy = std::min(static_cast<size_t>(gy), meshY - 2);
+    fx = gx - static_cast<float>(ix);
+    fy = gy - static_cast<float>(iy);
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "../Common/FFT.h"
+
+// Particle-particle particle-mesh (PPPM) Coulomb solver for the Atomic box.
+// The 1/r^2 force is split with a Gaussian of width 1/alpha:
+//  - short range: erfc-screened pairs inside the cutoff, found with a cell list
+//  - long range : smooth remainder, CIC charge assignment on a mesh and an FFT
+//                 convolution with the precomputed field kernel
+// The mesh is zero-padded to twice the box, so the box is isolated (no
+// periodic images), matching the walls of the simulation.
+class PPPMSolver
+{
+public:
+    PPPMSolver(const sf::Vector2f& maxSize, const sf::Vector2f& minSize,
+        float coulombConstant = 1.0f, float cutoff = 40.0f, float meshSpacing = 10.0f);
+
+    // forces[i] = sum_j k q_i q_j (r_i - r_j) / |r_i - r_j|^3
+    void computeForces(const std::vector<sf::Vector2f>& positions, const std::vector<float>& charges,
+        std::vector<sf::Vector2f>& forces);
+
+    float getCutoff() const { return cutoff; }
+    float getSplitting() const { return alpha; }
+
+private:
+    const sf::Vector2f maxSize;
+    const sf::Vector2f minSize;
+    const float coulombConstant;
+    const float cutoff;
+    const float alpha;
+    const float meshSpacing;
+
+    // Mesh covering the box (meshX x meshY) inside a padded FFT grid
+    size_t meshX;
+    size_t meshY;
+    FFT2D fft;
+    std::vector<FFT2D::Complex> kernelX;    // FFT of the long-range field kernel
+    std::vector<FFT2D::Complex> kernelY;
+    std::vector<FFT2D::Complex> density;
+    std::vector<FFT2D::Complex> fieldX;
+    std::vector<FFT2D::Complex> fieldY;
+
+    // Cell list for the short-range pairs (cell size = cutoff)
+    unsigned int cellsX;
+    unsigned int cellsY;
+    std::vector<uint32_t> cellStart;
+    std::vector<uint32_t> cellParticles;
+    std::vector<uint32_t> cellCursor;   // counting sort scratch
+
+    void buildKernel();
+    void shortRange(const std::vector<sf::Vector2f>& positions, const std::vector<float>& charges,
+        std::vector<sf::Vector2f>& forces);
+    void longRange(const std::vector<sf::Vector2f>& positions, const std::vector<float>& charges,
+        std::vector<sf::Vector2f>& forces);
+
+    // Cloud-in-cell weights of a position on the mesh
+    void meshWeights(const sf::Vector2f& position, size_t& ix, size_t& iy, float& fx, float& fy) const;
+};
@@ -5,7 +5,7 @@
 
 // -------------Constructor / Destructor----------------
 Particle::Particle(float x, float y, float m)
-    : Position(x, y), Velocity(0.f, 0.f), mass(m), angleV(0.0f), Rotation(0.0f)
+    : Position(x, y), Velocity(0.f, 0.f), mass(m), angleV(0.0f), Rotation(0.0f), charge(0.0f)
 {
 }
 
@@ -9,6 +9,7 @@ private:
     float mass;
     float angleV;
     float Rotation;
+    float charge;
 
 public:
     // State variables
@@ -28,9 +29,12 @@ public:
     float& getAngleV() { return angleV; }
     const float& getAngleV() const { return angleV; }
     float getRotation() const { return Rotation; }
+    float getCharge() const { return charge; }
 
     // Setters
     void setAngleV(float v) { angleV = v; }
+    void setRotation(float r) { Rotation = r; }
+    void setCharge(float q) { charge = q; }
 
     // Core methods
     void Initialize();
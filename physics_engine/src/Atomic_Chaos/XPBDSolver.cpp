@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <cmath>
+#include "XPBDSolver.h"
+#include "Bonds.h"
+
+// -------------Constructor----------------
+XPBDSolver::XPBDSolver(const sf::Vector2f& maxSize, const sf::Vector2f& minSize, int substeps)
+    : maxSize(maxSize), minSize(minSize), substeps(substeps)
+{
+}
+
+// -------------Frame step----------------
+void XPBDSolver::step(std::vector<Particle>& particles, BondSolver* bonds, float dt)
+{
+    const size_t count = particles.size();
+    if (count == 0 || substeps <= 0) return;
+
+    // Gather
+    positions.resize(count);
+    previousPositions.resize(count);
+    velocities.resize(count);
+    preSolveVelocities.resize(count);
+    angularVelocities.resize(count);
+    rotations.resize(count);
+    inverseMasses.resize(count);
+    radii.resize(count);
+    wallContacts.resize(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        positions[i] = particles[i].Position;
+        velocities[i] = particles[i].Velocity;
+        angularVelocities[i] = particles[i].getAngleV();
+        rotations[i] = particles[i].getRotation();
+        inverseMasses[i] = 1.0f / particles[i].getMass();
+        radii[i] = particles[i].shape.getRadius();
+    }
+
+    // Single collision detection for the whole frame
+    findCandidates(dt);
+
+    const float h = dt / static_cast<float>(substeps);
+    const float spinDamping = std::pow(0.99f, 1.0f / static_cast<float>(substeps));
+
+    for (int s = 0; s < substeps; ++s)
+    {
+        // Predict
+        for (size_t i = 0; i < count; ++i)
+        {
+            previousPositions[i] = positions[i];
+            preSolveVelocities[i] = velocities[i];
+            positions[i] += velocities[i] * h;
+
+            rotations[i] += angularVelocities[i] * h;
+            angularVelocities[i] *= spinDamping;
+        }
+
+        // Project
+        solveContacts();
+        solveWalls();
+        if (bonds)
+        {
+            bonds->resetMultipliers();
+            bonds->project(positions, inverseMasses, h);
+        }
+
+        // Derive velocities, then fix them up at contacts
+        for (size_t i = 0; i < count; ++i)
+            velocities[i] = (positions[i] - previousPositions[i]) / h;
+
+        solveVelocities(h);
+    }
+
+    // Scatter
+    for (size_t i = 0; i < count; ++i)
+    {
+        Particle& p = particles[i];
+        p.Position = positions[i];
+        p.Velocity = velocities[i];
+        p.setAngleV(angularVelocities[i]);
+        p.setRotation(rotations[i]);
+
+        // Sync visual shapes
+        p.shape.setPosition(p.Position);
+        p.shape.setRotation(sf::radians(rotations[i]));
+        p.axis.setPosition(p.Position);
+        p.axis.setRotation(sf::radians(rotations[i]));
+    }
+}
+
+// -------------Broadphase----------------
+// Every pair that can come into contact during the frame, from a cell list
+// whose cells are as wide as the largest contact distance plus the travel margin
+void XPBDSolver::findCandidates(float dt)
+{
+    const size_t count = positions.size();
+
+    float maxRadius = 0.0f;
+    float maxSpeed = 0.0f;
+    for (size_t i = 0; i < count; ++i)
+    {
+        maxRadius = std::max(maxRadius, radii[i]);
+        maxSpeed = std::max(maxSpeed, std::sqrt(velocities[i].x * velocities[i].x + velocities[i].y * velocities[i].y));
+    }
+
+    const float margin = 2.0f * maxSpeed * dt + 0.5f;
+    const float cellSize = 2.0f * maxRadius + margin;
+    const int cellsX = std::max(1, static_cast<int>(std::ceil((maxSize.x - minSize.x) / cellSize)));
+    const int cellsY = std::max(1, static_cast<int>(std::ceil((maxSize.y - minSize.y) / cellSize)));
+
+    auto cellOf = [&](const sf::Vector2f& p)
+    {
+        int cx = std::clamp(static_cast<int>((p.x - minSize.x) / cellSize), 0, cellsX - 1);
+        int cy = std::clamp(static_cast<int>((p.y - minSize.y) / cellSize), 0, cellsY - 1);
+        return cy * cellsX + cx;
+    };
+
+    cellStart.assign(static_cast<size_t>(cellsX) * cellsY + 1, 0);
+    for (size_t i = 0; i < count; ++i)
+        cellStart[cellOf(positions[i]) + 1]++;
+    for (size_t c = 1; c < cellStart.size(); ++c)
+        cellStart[c] += cellStart[c - 1];
+
+    cellParticles.resize(count);
+    std::vector<uint32_t> cursor(cellStart.begin(), cellStart.end() - 1);
+    for (size_t i = 0; i < count; ++i)
+        cellParticles[cursor[cellOf(positions[i])]++] = static_cast<uint32_t>(i);
+
+    candidates.clear();
+    auto consider = [&](uint32_t a, uint32_t b)
+    {
+        sf::Vector2f d = positions[a] - positions[b];
+        float reach = radii[a] + radii[b] + margin;
+        if (d.x * d.x + d.y * d.y < reach * reach)
+            candidates.push_back({ a, b, 0.0f, sf::Vector2f(1.f, 0.f), false });
+    };
+
+    // Half stencil over neighbouring cells
+    const int neighbourX[4] = { 1, -1, 0, 1 };
+    const int neighbourY[4] = { 0, 1, 1, 1 };
+
+    for (int cy = 0; cy < cellsY; ++cy)
+    {
+        for (int cx = 0; cx < cellsX; ++cx)
+        {
+            int cell = cy * cellsX + cx;
+            for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i)
+            {
+                for (uint32_t j = i + 1; j < cellStart[cell + 1]; ++j)
+                    consider(cellParticles[i], cellParticles[j]);
+
+                for (int n = 0; n < 4; ++n)
+                {
+                    int nx = cx + neighbourX[n];
+                    int ny = cy + neighbourY[n];
+                    if (nx < 0 || nx >= cellsX || ny >= cellsY) continue;
+
+                    int other = ny * cellsX + nx;
+                    for (uint32_t j = cellStart[other]; j < cellStart[other + 1]; ++j)
+                        consider(cellParticles[i], cellParticles[j]);
+                }
+            }
+        }
+    }
+}
+
+// -------------Position projection----------------
+void XPBDSolver::solveContacts()
+{
+    for (auto& contact : candidates)
+    {
+        contact.active = false;
+        contact.normalImpulse = 0.0f;
+
+        sf::Vector2f d = positions[contact.a] - positions[contact.b];
+        float dist = std::sqrt(d.x * d.x + d.y * d.y);
+        float radiusSum = radii[contact.a] + radii[contact.b];
+        if (dist >= radiusSum) continue;
+
+        // Near-zero distance case
+        sf::Vector2f normal = dist < 1e-6f ? sf::Vector2f(1.0f, 0.0f) : d / dist;
+
+        // Rigid non-penetration: C = dist - (ra + rb) >= 0
+        float wa = inverseMasses[contact.a];
+        float wb = inverseMasses[contact.b];
+        float deltaLambda = (radiusSum - dist) / (wa + wb);
+
+        positions[contact.a] += normal * (wa * deltaLambda);
+        positions[contact.b] -= normal * (wb * deltaLambda);
+
+        contact.active = true;
+        contact.normal = normal;
+        contact.normalImpulse = deltaLambda;   // divided by h in the velocity pass
+    }
+}
+
+void XPBDSolver::solveWalls()
+{
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        sf::Vector2f& p = positions[i];
+        float r = radii[i];
+        uint8_t flags = 0;
+
+        if (p.x < minSize.x + r) { p.x = minSize.x + r; flags |= 1; }
+        if (p.x > maxSize.x - r) { p.x = maxSize.x - r; flags |= 2; }
+        if (p.y < minSize.y + r) { p.y = minSize.y + r; flags |= 4; }
+        if (p.y > maxSize.y - r) { p.y = maxSize.y - r; flags |= 8; }
+
+        wallContacts[i] = flags;
+    }
+}
+
+// -------------Velocity pass----------------
+void XPBDSolver::solveVelocities(float h)
+{
+    for (const auto& contact : candidates)
+    {
+        if (!contact.active) continue;
+
+        const uint32_t a = contact.a, b = contact.b;
+        const float wa = inverseMasses[a], wb = inverseMasses[b];
+        const float ra = radii[a], rb = radii[b];
+        const sf::Vector2f n = contact.normal;
+        const sf::Vector2f t(-n.y, n.x);
+
+        // Restitution against the pre-solve approach speed
+        sf::Vector2f v = velocities[a] - velocities[b];
+        sf::Vector2f vBar = preSolveVelocities[a] - preSolveVelocities[b];
+        float v_n = v.x * n.x + v.y * n.y;
+        float vBar_n = vBar.x * n.x + vBar.y * n.y;
+
+        float target = vBar_n < 0.0f ? -restitution * vBar_n : 0.0f;
+        float J_n = (target - v_n) / (wa + wb);
+        if (J_n < 0.0f) J_n = 0.0f;   // contacts only push
+
+        velocities[a] += n * (wa * J_n);
+        velocities[b] -= n * (wb * J_n);
+
+        // Friction & spin, as in Collision::resolveParticleCollision
+        float totalNormal = contact.normalImpulse / h + J_n;
+        v = velocities[a] - velocities[b];
+        float v_t = v.x * t.x + v.y * t.y + angularVelocities[a] * ra - angularVelocities[b] * rb;
+
+        // Solid discs: r^2 / I = 2 / m
+        float invMt = wa + wb + 2.0f * wa + 2.0f * wb;
+        float J_t = std::clamp(-v_t / invMt, -friction * totalNormal, friction * totalNormal);
+
+        velocities[a] += t * (wa * J_t);
+        velocities[b] -= t * (wb * J_t);
+        angularVelocities[a] += 2.0f * wa * J_t / ra;
+        angularVelocities[b] -= 2.0f * wb * J_t / rb;
+    }
+
+    // Walls reflect the pre-solve velocity, like the CCD wall response
+    for (size_t i = 0; i < velocities.size(); ++i)
+    {
+        uint8_t flags = wallContacts[i];
+        if (!flags) continue;
+
+        const sf::Vector2f& vBar = preSolveVelocities[i];
+        if (((flags & 1) && vBar.x < 0.0f) || ((flags & 2) && vBar.x > 0.0f))
+            velocities[i].x = -vBar.x * restitution;
+        if (((flags & 4) && vBar.y < 0.0f) || ((flags & 8) && vBar.y > 0.0f))
+            velocities[i].y = -vBar.y * restitution;
+    }
+}
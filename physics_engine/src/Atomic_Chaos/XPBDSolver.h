@@ -0,0 +1,63 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "Particle.h"
+
+class BondSolver;
+
+// Extended position-based dynamics (XPBD) step for the Atomic particles.
+// One broadphase per frame gathers every pair that can touch within the
+// frame; the frame is then split into cheap substeps:
+//   predict x += v h -> project contacts, walls and bonds -> v = dx / h
+//   -> velocity pass (restitution, friction and spin, as in Collision)
+class XPBDSolver
+{
+public:
+    XPBDSolver(const sf::Vector2f& maxSize, const sf::Vector2f& minSize, int substeps = 8);
+
+    void setSubsteps(int count) { substeps = count; }
+    int getSubsteps() const { return substeps; }
+
+    // Advances the particles by dt; bonds (optional) are projected every substep
+    void step(std::vector<Particle>& particles, BondSolver* bonds, float dt);
+
+    size_t candidateCount() const { return candidates.size(); }
+
+private:
+    const sf::Vector2f maxSize;
+    const sf::Vector2f minSize;
+    int substeps;
+
+    const float restitution = 1.0f;     // same as the impulse solver
+    const float friction = 0.5f;
+
+    struct Contact
+    {
+        uint32_t a, b;
+        float normalImpulse;     // accumulated this substep
+        sf::Vector2f normal;     // from b to a
+        bool active;
+    };
+    std::vector<Contact> candidates;
+
+    // Gathered state
+    std::vector<sf::Vector2f> positions;
+    std::vector<sf::Vector2f> previousPositions;
+    std::vector<sf::Vector2f> velocities;
+    std::vector<sf::Vector2f> preSolveVelocities;
+    std::vector<float> angularVelocities;
+    std::vector<float> rotations;
+    std::vector<float> inverseMasses;
+    std::vector<float> radii;
+    std::vector<uint8_t> wallContacts;    // bit 0..3 = left, right, top, bottom
+
+    // Broadphase cell list
+    std::vector<uint32_t> cellStart;
+    std::vector<uint32_t> cellParticles;
+
+    void findCandidates(float dt);
+    void solveContacts();
+    void solveWalls();
+    void solveVelocities(float h);
+};
@@ -0,0 +1,110 @@
+#include "FFT.h"
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+FFT2D::FFT2D(size_t width, size_t height)
+    : width(width), height(height)
+{
+    if (!isPowerOfTwo(width) || !isPowerOfTwo(height))
+        throw std::invalid_argument("FFT2D: grid sizes must be powers of two");
+
+    buildTables(width, twiddlesX, reverseX);
+    buildTables(height, twiddlesY, reverseY);
+}
+
+size_t FFT2D::nextPowerOfTwo(size_t n)
+{
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+void FFT2D::forward(std::vector<Complex>& grid) const
+{
+    transform(grid, false);
+}
+
+void FFT2D::inverse(std::vector<Complex>& grid) const
+{
+    transform(grid, true);
+
+    const float scale = 1.0f / static_cast<float>(width * height);
+    for (auto& value : grid)
+        value *= scale;
+}
+
+void FFT2D::transform(std::vector<Complex>& grid, bool inverse) const
+{
+    // Rows are contiguous
+    for (size_t y = 0; y < height; ++y)
+        transform1D(grid.data() + y * width, width, twiddlesX, reverseX, inverse);
+
+    // Columns go through a contiguous buffer
+    std::vector<Complex> column(height);
+    for (size_t x = 0; x < width; ++x)
+    {
+        for (size_t y = 0; y < height; ++y)
+            column[y] = grid[y * width + x];
+
+        transform1D(column.data(), height, twiddlesY, reverseY, inverse);
+
+        for (size_t y = 0; y < height; ++y)
+            grid[y * width + x] = column[y];
+    }
+}
+
+// Iterative Cooley-Tukey, decimation in time
+void FFT2D::transform1D(Complex* data, size_t n, const std::vector<Complex>& twiddles,
+    const std::vector<size_t>& reverse, bool inverse)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (i < reverse[i])
+            std::swap(data[i], data[reverse[i]]);
+    }
+
+    for (size_t length = 2; length <= n; length <<= 1)
+    {
+        const size_t half = length / 2;
+        const size_t step = n / length;
+
+        for (size_t start = 0; start < n; start += length)
+        {
+            for (size_t k = 0; k < half; ++k)
+            {
+                Complex w = twiddles[k * step];
+                if (inverse) w = std::conj(w);
+
+                Complex even = data[start + k];
+                Complex odd = data[start + k + half] * w;
+                data[start + k] = even + odd;
+                data[start + k + half] = even - odd;
+            }
+        }
+    }
+}
+
+void FFT2D::buildTables(size_t n, std::vector<Complex>& twiddles, std::vector<size_t>& reverse)
+{
+    const double twoPi = 6.283185307179586;
+
+    twiddles.resize(n / 2 > 0 ? n / 2 : 1);
+    for (size_t k = 0; k < twiddles.size(); ++k)
+    {
+        double angle = -twoPi * static_cast<double>(k) / static_cast<double>(n);
+        twiddles[k] = Complex(static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)));
+    }
+
+    unsigned int bits = 0;
+    while ((size_t(1) << bits) < n) bits++;
+
+    reverse.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        size_t r = 0;
+        for (unsigned int b = 0; b < bits; ++b)
+            if (i & (size_t(1) << b)) r |= size_t(1) << (bits - 1 - b);
+        reverse[i] = r;
+    }
+}
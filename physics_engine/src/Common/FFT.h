@@ -0,0 +1,37 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+// Built-in radix-2 complex FFT on a 2D grid (row-major, width x height,
+// both powers of two). Twiddles are precomputed per size; the inverse is
+// normalized so inverse(forward(x)) == x.
+class FFT2D
+{
+public:
+    using Complex = std::complex<float>;
+
+    FFT2D(size_t width = 1, size_t height = 1);
+
+    size_t getWidth() const { return width; }
+    size_t getHeight() const { return height; }
+
+    void forward(std::vector<Complex>& grid) const;
+    void inverse(std::vector<Complex>& grid) const;
+
+    static bool isPowerOfTwo(size_t n) { return n != 0 && (n & (n - 1)) == 0; }
+    static size_t nextPowerOfTwo(size_t n);
+
+private:
+    size_t width;
+    size_t height;
+    std::vector<Complex> twiddlesX;     // exp(-2 pi i k / width), k < width/2
+    std::vector<Complex> twiddlesY;
+    std::vector<size_t> reverseX;       // bit-reversal permutations
+    std::vector<size_t> reverseY;
+
+    void transform(std::vector<Complex>& grid, bool inverse) const;
+    static void transform1D(Complex* data, size_t n, const std::vector<Complex>& twiddles,
+        const std::vector<size_t>& reverse, bool inverse);
+    static void buildTables(size_t n, std::vector<Complex>& twiddles, std::vector<size_t>& reverse);
+};
@@ -0,0 +1,104 @@
+#include "MappedFile.h"
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+{
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("cannot open " + path);
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        throw std::runtime_error("cannot read the size of " + path);
+    }
+    length = static_cast<std::size_t>(fileSize.QuadPart);
+    if (length == 0)
+    {
+        CloseHandle(file);
+        return;
+    }
+
+    // The view keeps the mapping (and the file) alive after the handles close
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) throw std::runtime_error("cannot map " + path);
+    view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    CloseHandle(mapping);
+    if (!view) throw std::runtime_error("cannot map " + path);
+#else
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) throw std::runtime_error("cannot open " + path);
+
+    struct stat status;
+    if (fstat(descriptor, &status) != 0)
+    {
+        close(descriptor);
+        throw std::runtime_error("cannot read the size of " + path);
+    }
+    length = static_cast<std::size_t>(status.st_size);
+    if (length == 0)
+    {
+        close(descriptor);
+        return;
+    }
+
+    // The mapping stays valid after the descriptor closes
+    void* pointer = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (pointer == MAP_FAILED) throw std::runtime_error("cannot map " + path);
+#if defined(MADV_WILLNEED)
+    madvise(pointer, length, MADV_WILLNEED);
+#endif
+    view = static_cast<const char*>(pointer);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : view(std::exchange(other.view, nullptr)),
+    length(std::exchange(other.length, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        view = std::exchange(other.view, nullptr);
+        length = std::exchange(other.length, 0);
+    }
+    return *this;
+}
+
+void MappedFile::unmap()
+{
+    if (!view) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(view);
+#else
+    munmap(const_cast<char*>(view), length);
+#endif
+    view = nullptr;
+    length = 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-only memory map of a whole file (mmap / MapViewOfFile). Pages are
+// read in by the OS as they are first touched, so large files can be parsed
+// in parallel straight from the page cache without a copy.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    // Throws std::runtime_error when the file cannot be opened or mapped
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // nullptr for an empty file
+    const char* data() const { return view; }
+    std::size_t size() const { return length; }
+
+private:
+    const char* view = nullptr;
+    std::size_t length = 0;
+
+    void unmap();
+};
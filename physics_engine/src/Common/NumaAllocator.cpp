@@ -0,0 +1,74 @@
+#include "NumaAllocator.h"
+#include <atomic>
+#include <cstdlib>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+    // Below this, blocks come from the regular heap
+    const std::size_t PAGE_ALLOCATION_THRESHOLD = 64 * 1024;
+
+    std::atomic<bool> useHugePages{ false };
+}
+
+void NumaMemory::setHugePages(bool enabled)
+{
+    useHugePages = enabled;
+}
+
+bool NumaMemory::hugePages()
+{
+    return useHugePages;
+}
+
+void* NumaMemory::allocate(std::size_t bytes)
+{
+    if (bytes == 0) bytes = 1;
+
+    if (bytes < PAGE_ALLOCATION_THRESHOLD)
+    {
+        void* pointer = std::malloc(bytes);
+        if (!pointer) throw std::bad_alloc();
+        return pointer;
+    }
+
+#if defined(_WIN32)
+    // Committed pages are only backed by memory on first touch
+    void* pointer = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!pointer) throw std::bad_alloc();
+#else
+    void* pointer = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pointer == MAP_FAILED) throw std::bad_alloc();
+#if defined(MADV_HUGEPAGE)
+    if (useHugePages)
+        madvise(pointer, bytes, MADV_HUGEPAGE);
+#endif
+#endif
+    return pointer;
+}
+
+void NumaMemory::release(void* pointer, std::size_t bytes)
+{
+    if (!pointer) return;
+    if (bytes == 0) bytes = 1;
+
+    if (bytes < PAGE_ALLOCATION_THRESHOLD)
+    {
+        std::free(pointer);
+        return;
+    }
+
+#if defined(_WIN32)
+    VirtualFree(pointer, 0, MEM_RELEASE);
+#else
+    munmap(pointer, bytes);
+#endif
+}
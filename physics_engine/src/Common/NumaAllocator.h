@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Page-level allocation that leaves physical placement to the first touch.
+// Large blocks come straight from the OS (mmap / VirtualAlloc) and are never
+// written here, so whichever worker writes a page first gets it on its NUMA node.
+namespace NumaMemory
+{
+    // Ask for transparent huge pages (Linux madvise) on large blocks
+    void setHugePages(bool enabled);
+    bool hugePages();
+
+    void* allocate(std::size_t bytes);
+    void release(void* pointer, std::size_t bytes);
+}
+
+// Allocator for trivially constructible element types. Elements are
+// default-initialized (not zeroed) on resize, so growing a vector does not
+// touch its pages on the calling thread.
+template <typename T>
+class NumaAllocator
+{
+public:
+    using value_type = T;
+
+    NumaAllocator() = default;
+    template <typename U>
+    NumaAllocator(const NumaAllocator<U>&) {}
+
+    T* allocate(std::size_t count)
+    {
+        return static_cast<T*>(NumaMemory::allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, std::size_t count)
+    {
+        NumaMemory::release(pointer, count * sizeof(T));
+    }
+
+    template <typename U>
+    void construct(U* pointer)
+    {
+        ::new (static_cast<void*>(pointer)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* pointer, Args&&... args)
+    {
+        ::new (static_cast<void*>(pointer)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    bool operator==(const NumaAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const NumaAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using NumaVector = std::vector<T, NumaAllocator<T>>;
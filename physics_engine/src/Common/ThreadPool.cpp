@@ -0,0 +1,195 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// -------------Constructor / Destructor----------------
+ThreadPool::ThreadPool(unsigned int threadCount, bool pinThreads)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    queues.reset(new TaskQueue[threadCount]);
+
+    std::vector<unsigned int> cpus;
+    if (pinThreads)
+        cpus = cpusByNumaNode();
+
+    workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        if (!cpus.empty())
+            pinThread(workers.back(), cpus[i % cpus.size()]);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+// -------------Dispatch----------------
+void ThreadPool::runOnWorkers(const std::function<void(unsigned int)>& job)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    currentJob = &job;
+    pending = size();
+    generation++;
+    wake.notify_all();
+
+    done.wait(lock, [this] { return pending == 0; });
+    currentJob = nullptr;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, size_t, unsigned int)>& job)
+{
+    const size_t workerCount = size();
+    runOnWorkers([&](unsigned int worker)
+    {
+        size_t begin = count * worker / workerCount;
+        size_t end = count * (worker + 1) / workerCount;
+        if (begin < end)
+            job(begin, end, worker);
+    });
+}
+
+void ThreadPool::parallelTasks(size_t taskCount, const std::function<void(size_t, unsigned int)>& job)
+{
+    const size_t workerCount = size();
+    for (size_t w = 0; w < workerCount; ++w)
+    {
+        std::lock_guard<std::mutex> lock(queues[w].lock);
+        queues[w].next = taskCount * w / workerCount;
+        queues[w].end = taskCount * (w + 1) / workerCount;
+    }
+
+    // No tasks are added while running, so a worker that finds every queue
+    // empty is done
+    runOnWorkers([&](unsigned int worker)
+    {
+        size_t task;
+        while (popTask(worker, task) || stealTask(worker, task))
+            job(task, worker);
+    });
+}
+
+bool ThreadPool::popTask(unsigned int worker, size_t& task)
+{
+    TaskQueue& queue = queues[worker];
+    std::lock_guard<std::mutex> lock(queue.lock);
+    if (queue.next == queue.end) return false;
+
+    task = queue.next++;
+    return true;
+}
+
+bool ThreadPool::stealTask(unsigned int thief, size_t& task)
+{
+    const unsigned int workerCount = size();
+    for (unsigned int offset = 1; offset < workerCount; ++offset)
+    {
+        TaskQueue& queue = queues[(thief + offset) % workerCount];
+        std::lock_guard<std::mutex> lock(queue.lock);
+        if (queue.next == queue.end) continue;
+
+        task = --queue.end;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(unsigned int index)
+{
+    unsigned long long seen = 0;
+
+    while (true)
+    {
+        const std::function<void(unsigned int)>* job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+
+            seen = generation;
+            job = currentJob;
+        }
+
+        (*job)(index);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0)
+            done.notify_one();
+    }
+}
+
+// -------------Topology / affinity----------------
+std::vector<unsigned int> ThreadPool::cpusByNumaNode()
+{
+    std::vector<unsigned int> cpus;
+
+#if defined(__linux__)
+    // e.g. /sys/devices/system/node/node1/cpulist = "16-31,48-63"
+    for (unsigned int node = 0; ; ++node)
+    {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!file) break;
+
+        std::string list;
+        std::getline(file, list);
+        std::stringstream ranges(list);
+        std::string range;
+        while (std::getline(ranges, range, ','))
+        {
+            if (range.empty()) continue;
+            size_t dash = range.find('-');
+            unsigned int first = static_cast<unsigned int>(std::stoul(range.substr(0, dash)));
+            unsigned int last = dash == std::string::npos ? first : static_cast<unsigned int>(std::stoul(range.substr(dash + 1)));
+            for (unsigned int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+    }
+#endif
+
+    if (cpus.empty())
+    {
+        unsigned int count = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int cpu = 0; cpu < count; ++cpu)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+void ThreadPool::pinThread(std::thread& thread, unsigned int cpu)
+{
+#if defined(_WIN32)
+    if (cpu < 64)
+        SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << cpu);
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)cpu;
+#endif
+}
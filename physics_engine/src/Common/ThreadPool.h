@@ -0,0 +1,66 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads with stable identities.
+// Worker w always runs the w-th share of a parallel call, so data a worker
+// first touched stays local to it. With pinning enabled, workers are bound to
+// CPUs ordered by NUMA node (worker 0..k-1 on node 0, and so on).
+// parallelTasks schedules dynamically instead: every worker starts on its own
+// block of tasks and steals from the end of other blocks when it runs dry.
+class ThreadPool
+{
+public:
+    // threadCount 0 = one worker per hardware thread
+    explicit ThreadPool(unsigned int threadCount = 0, bool pinThreads = false);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+    // Runs job(worker) once on every worker and blocks until all are done
+    void runOnWorkers(const std::function<void(unsigned int)>& job);
+
+    // Static partition of [0, count): worker w always gets the same range
+    void parallelFor(size_t count, const std::function<void(size_t, size_t, unsigned int)>& job);
+
+    // Runs job(task, worker) for every task in [0, taskCount) with work stealing.
+    // Which worker runs a task varies; the set of tasks does not
+    void parallelTasks(size_t taskCount, const std::function<void(size_t, unsigned int)>& job);
+
+    // CPUs in NUMA node order (identity order when the topology is unknown)
+    static std::vector<unsigned int> cpusByNumaNode();
+
+private:
+    std::vector<std::thread> workers;
+
+    // Remaining tasks [next, end) of one worker; the owner takes from the
+    // front, thieves from the back
+    struct alignas(64) TaskQueue
+    {
+        std::mutex lock;
+        size_t next = 0;
+        size_t end = 0;
+    };
+    std::unique_ptr<TaskQueue[]> queues;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(unsigned int)>* currentJob = nullptr;
+    unsigned long long generation = 0;
+    unsigned int pending = 0;
+    bool stopping = false;
+
+    void workerLoop(unsigned int index);
+    bool popTask(unsigned int worker, size_t& task);
+    bool stealTask(unsigned int thief, size_t& task);
+    static void pinThread(std::thread& thread, unsigned int cpu);
+};
@@ -0,0 +1,266 @@
+#include "BarnesHut.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const int MAX_LEVEL = 16;   // 16 bits per axis in the Morton code
+}
+
+// -------------Morton order----------------
+// Interleave the low 16 bits of v with zeros: ...dcba -> ...0d0c0b0a
+uint32_t BarnesHutTree::spread_bits(uint32_t v)
+{
+    v &= 0x0000FFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+void BarnesHutTree::sort_by_morton(const float* pos_x, const float* pos_y, size_t count)
+{
+    // Square root cell around all bodies
+    float min_x = pos_x[0], max_x = pos_x[0];
+    float min_y = pos_y[0], max_y = pos_y[0];
+    for (size_t i = 1; i < count; i++) {
+        min_x = std::min(min_x, pos_x[i]); max_x = std::max(max_x, pos_x[i]);
+        min_y = std::min(min_y, pos_y[i]); max_y = std::max(max_y, pos_y[i]);
+    }
+
+    root_size = std::max(max_x - min_x, max_y - min_y) * 1.0001f;
+    if (root_size <= 0.f) root_size = 1.f;
+    root_x = min_x;
+    root_y = min_y;
+
+    codes.resize(count);
+    order.resize(count);
+    const float scale = 65535.f / root_size;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t qx = static_cast<uint32_t>(std::min(65535.f, (pos_x[i] - root_x) * scale));
+        uint32_t qy = static_cast<uint32_t>(std::min(65535.f, (pos_y[i] - root_y) * scale));
+        codes[i] = spread_bits(qx) | (spread_bits(qy) << 1);
+        order[i] = static_cast<uint32_t>(i);
+    }
+
+    // LSD radix sort, 4 passes of 8 bits
+    scratch_codes.resize(count);
+    scratch_order.resize(count);
+    for (int shift = 0; shift < 32; shift += 8) {
+        size_t histogram[257] = {};
+        for (size_t i = 0; i < count; i++)
+            histogram[((codes[i] >> shift) & 0xFF) + 1]++;
+        for (int b = 0; b < 256; b++)
+            histogram[b + 1] += histogram[b];
+
+        for (size_t i = 0; i < count; i++) {
+            size_t slot = histogram[(codes[i] >> shift) & 0xFF]++;
+            scratch_codes[slot] = codes[i];
+            scratch_order[slot] = order[i];
+        }
+        codes.swap(scratch_codes);
+        order.swap(scratch_order);
+    }
+}
+
+// -------------Build----------------
+void BarnesHutTree::build(const float* pos_x, const float* pos_y, const float* mass, size_t count)
+{
+    // An empty build leaves nothing of the last one for accelerations() to visit
+    nodes.clear();
+    order.clear();
+    codes.clear();
+    sorted_x.clear();
+    sorted_y.clear();
+    sorted_mass.clear();
+    if (count == 0) return;
+
+    sort_by_morton(pos_x, pos_y, count);
+
+    sorted_x.resize(count);
+    sorted_y.resize(count);
+    sorted_mass.resize(count);
+    for (size_t k = 0; k < count; k++) {
+        sorted_x[k] = pos_x[order[k]];
+        sorted_y[k] = pos_y[order[k]];
+        sorted_mass[k] = mass[order[k]];
+    }
+
+    // Breadth-first: the children of a node are appended together, so they
+    // are contiguous and always stored after their parent
+    nodes.push_back({ 0.f, 0.f, 0.f, root_size, 0, 0, 0, static_cast<uint32_t>(count) });
+    levels.assign(1, 0);
+
+    for (size_t n = 0; n < nodes.size(); n++) {
+        const uint32_t begin = nodes[n].body_begin;
+        const uint32_t end = nodes[n].body_end;
+        const int level = levels[n];
+        if (end - begin <= leaf_size || level >= MAX_LEVEL) continue;
+
+        // Bodies of this node share the first 'level' Morton digits, so the
+        // next digit splits the sorted range into (up to) four sub-ranges
+        const int shift = 30 - 2 * level;
+        const float child_size = nodes[n].size * 0.5f;
+        const uint32_t first_child = static_cast<uint32_t>(nodes.size());
+
+        uint32_t range_begin = begin;
+        for (uint32_t digit = 0; digit < 4; digit++) {
+            uint32_t range_end = end;
+            if (digit < 3) {
+                auto split = std::partition_point(codes.begin() + range_begin, codes.begin() + end,
+                    [&](uint32_t code) { return ((code >> shift) & 3u) <= digit; });
+                range_end = static_cast<uint32_t>(split - codes.begin());
+            }
+
+            if (range_end > range_begin) {
+                nodes.push_back({ 0.f, 0.f, 0.f, child_size, 0, 0, range_begin, range_end });
+                levels.push_back(static_cast<uint8_t>(level + 1));
+            }
+            range_begin = range_end;
+        }
+
+        nodes[n].first_child = first_child;
+        nodes[n].child_count = static_cast<uint32_t>(nodes.size()) - first_child;
+    }
+
+    // Mass and center of mass, children before parents
+    for (size_t n = nodes.size(); n-- > 0;) {
+        Node& node = nodes[n];
+        float m = 0.f, mx = 0.f, my = 0.f;
+
+        if (node.child_count == 0) {
+            for (uint32_t k = node.body_begin; k < node.body_end; k++) {
+                m += sorted_mass[k];
+                mx += sorted_mass[k] * sorted_x[k];
+                my += sorted_mass[k] * sorted_y[k];
+            }
+        }
+        else {
+            for (uint32_t c = node.first_child; c < node.first_child + node.child_count; c++) {
+                m += nodes[c].mass;
+                mx += nodes[c].mass * nodes[c].com_x;
+                my += nodes[c].mass * nodes[c].com_y;
+            }
+        }
+
+        node.mass = m;
+        if (m > 0.f) {
+            node.com_x = mx / m;
+            node.com_y = my / m;
+        }
+        else {
+            node.com_x = sorted_x[node.body_begin];
+            node.com_y = sorted_y[node.body_begin];
+        }
+    }
+}
+
+// -------------Traversal----------------
+void BarnesHutTree::acceleration(float x, float y, float G, float epsilon, float& ax, float& ay) const
+{
+    ax = 0.f;
+    ay = 0.f;
+    if (nodes.empty()) return;
+
+    const float theta2 = opening_angle * opening_angle;
+    const float epsilon2 = epsilon * epsilon;
+
+    // At most 3 siblings wait per level
+    uint32_t stack[4 * MAX_LEVEL + 4];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+
+        if (node.child_count == 0) {
+            // Leaf: direct sum, same rules as the direct solver
+            for (uint32_t k = node.body_begin; k < node.body_end; k++) {
+                float dx = sorted_x[k] - x;
+                float dy = sorted_y[k] - y;
+                float dist2 = dx * dx + dy * dy;
+                if (dist2 < epsilon2) continue;
+
+                float dist = std::sqrt(dist2);
+                float accel_mag = G * sorted_mass[k] / (dist2 * dist);
+                ax += dx * accel_mag;
+                ay += dy * accel_mag;
+            }
+            continue;
+        }
+
+        float dx = node.com_x - x;
+        float dy = node.com_y - y;
+        float dist2 = dx * dx + dy * dy;
+
+        if (node.size * node.size < theta2 * dist2) {
+            // Far enough: the node acts as a point mass
+            float dist = std::sqrt(dist2);
+            float accel_mag = G * node.mass / (dist2 * dist);
+            ax += dx * accel_mag;
+            ay += dy * accel_mag;
+        }
+        else {
+            for (uint32_t c = node.first_child; c < node.first_child + node.child_count; c++)
+                stack[top++] = c;
+        }
+    }
+}
+
+void BarnesHutTree::sample(float x, float y, float G, float softening, float& potential, float& ax, float& ay) const
+{
+    potential = 0.f;
+    ax = 0.f;
+    ay = 0.f;
+    if (nodes.empty()) return;
+
+    const float theta2 = opening_angle * opening_angle;
+    const float softening2 = softening * softening;
+
+    uint32_t stack[4 * MAX_LEVEL + 4];
+    int top = 0;
+    stack[top++] = 0;
+
+    // Same walk as acceleration(), one term per body or accepted node
+    auto add = [&](float dx, float dy, float mass) {
+        float dist2 = dx * dx + dy * dy + softening2;
+        float inv_dist = 1.f / std::sqrt(dist2);
+        float gm = G * mass * inv_dist;
+        potential -= gm;
+        ax += dx * gm * inv_dist * inv_dist;
+        ay += dy * gm * inv_dist * inv_dist;
+    };
+
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+
+        if (node.child_count == 0) {
+            for (uint32_t k = node.body_begin; k < node.body_end; k++)
+                add(sorted_x[k] - x, sorted_y[k] - y, sorted_mass[k]);
+            continue;
+        }
+
+        float dx = node.com_x - x;
+        float dy = node.com_y - y;
+        if (node.size * node.size < theta2 * (dx * dx + dy * dy)) {
+            add(dx, dy, node.mass);
+        }
+        else {
+            for (uint32_t c = node.first_child; c < node.first_child + node.child_count; c++)
+                stack[top++] = c;
+        }
+    }
+}
+
+void BarnesHutTree::accelerations(float G, float epsilon, float* acc_x, float* acc_y) const
+{
+    accelerations(0, order.size(), G, epsilon, acc_x, acc_y);
+}
+
+void BarnesHutTree::accelerations(size_t begin, size_t end, float G, float epsilon, float* acc_x, float* acc_y) const
+{
+    // Morton order keeps consecutive walks on nearly the same nodes
+    for (size_t k = begin; k < end; k++)
+        acceleration(sorted_x[k], sorted_y[k], G, epsilon, acc_x[order[k]], acc_y[order[k]]);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Barnes-Hut quadtree for 2D gravity.
+// Bodies are sorted by Morton code (LSD radix sort, linear time) and the tree
+// is built top-down over the sorted order: the bodies of every node are a
+// contiguous range and its children split that range by the next 2-bit
+// Morton digit. Depth is bounded by the 16-bit quantization, so construction
+// is O(n). A node is opened when size / distance >= theta.
+class BarnesHutTree
+{
+public:
+    struct Node
+    {
+        float com_x, com_y;     // center of mass
+        float mass;
+        float size;             // side length of the node square
+        uint32_t first_child;   // children are contiguous
+        uint32_t child_count;   // 0 = leaf
+        uint32_t body_begin;    // range in sorted order
+        uint32_t body_end;
+    };
+
+    void set_opening_angle(float theta) { opening_angle = theta; }
+    float get_opening_angle() const { return opening_angle; }
+    void set_leaf_size(uint32_t size) { leaf_size = size; }
+
+    void build(const float* pos_x, const float* pos_y, const float* mass, size_t count);
+
+    // Acceleration at a point (bodies closer than epsilon are ignored)
+    void acceleration(float x, float y, float G, float epsilon, float& ax, float& ay) const;
+
+    // Potential and acceleration at a point, Plummer-softened by softening
+    // (for sampling the field away from the bodies)
+    void sample(float x, float y, float G, float softening, float& potential, float& ax, float& ay) const;
+
+    // Accelerations of all bodies the tree was built from (visited in Morton order)
+    void accelerations(float G, float epsilon, float* acc_x, float* acc_y) const;
+
+    // Same for the bodies at Morton positions [begin, end), so independent
+    // ranges can run on different threads
+    void accelerations(size_t begin, size_t end, float G, float epsilon, float* acc_x, float* acc_y) const;
+
+    size_t size() const { return order.size(); }
+
+    const std::vector<Node>& get_nodes() const { return nodes; }
+    const std::vector<uint32_t>& get_order() const { return order; }
+
+private:
+    float opening_angle = 0.5f;
+    uint32_t leaf_size = 8;
+
+    std::vector<Node> nodes;
+    std::vector<uint8_t> levels;   // build scratch
+
+    // Bodies in Morton order (copied for locality during traversal)
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> codes;
+    std::vector<float> sorted_x, sorted_y, sorted_mass;
+
+    // Radix sort scratch
+    std::vector<uint32_t> scratch_codes;
+    std::vector<uint32_t> scratch_order;
+
+    float root_x = 0.f, root_y = 0.f, root_size = 0.f;
+
+    void sort_by_morton(const float* pos_x, const float* pos_y, size_t count);
+    static uint32_t spread_bits(uint32_t v);
+};
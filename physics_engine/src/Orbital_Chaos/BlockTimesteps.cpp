@@ -0,0 +1,194 @@
+#include "BlockTimesteps.h"
+#include "../Common/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const size_t TASK_BODIES = 64;
+
+    template <typename T>
+    T length(T x, T y) { return std::sqrt(x * x + y * y); }
+}
+
+// -------------Step----------------
+template <typename T>
+void BlockTimestepIntegrator<T>::step(T* pos_x, T* pos_y, T* vel_x, T* vel_y, const T* mass,
+    size_t count, T dt, T G, T epsilon)
+{
+    if (count == 0 || dt <= T(0)) return;
+
+    const double tick_dt = static_cast<double>(dt) / static_cast<double>(SPAN);
+
+    pred_x.assign(pos_x, pos_x + count);
+    pred_y.assign(pos_y, pos_y + count);
+    pred_vx.assign(vel_x, vel_x + count);
+    pred_vy.assign(vel_y, vel_y + count);
+
+    if (!initialized || acc_x.size() != count) {
+        acc_x.resize(count); acc_y.resize(count);
+        jerk_x.resize(count); jerk_y.resize(count);
+        new_acc_x.resize(count); new_acc_y.resize(count);
+        new_jerk_x.resize(count); new_jerk_y.resize(count);
+        ticks.assign(count, 0);
+        step_ticks.resize(count);
+
+        active.resize(count);
+        for (size_t i = 0; i < count; i++)
+            active[i] = static_cast<uint32_t>(i);
+        evaluate(active, mass, count, G, epsilon);
+
+        // First step from |a| / |a'| only
+        for (size_t i = 0; i < count; i++) {
+            acc_x[i] = new_acc_x[i]; acc_y[i] = new_acc_y[i];
+            jerk_x[i] = new_jerk_x[i]; jerk_y[i] = new_jerk_y[i];
+
+            T a = length(acc_x[i], acc_y[i]);
+            T j = length(jerk_x[i], jerk_y[i]);
+            double wanted = j > T(0) ? start_accuracy * a / j : static_cast<double>(dt);
+            step_ticks[i] = quantize(wanted, tick_dt, SPAN, 0);
+        }
+        initialized = true;
+    }
+
+    while (true) {
+        // Next block time and the bodies due at it
+        uint64_t now = SPAN;
+        for (size_t i = 0; i < count; i++)
+            now = std::min(now, ticks[i] + step_ticks[i]);
+
+        active.clear();
+        for (size_t i = 0; i < count; i++)
+            if (ticks[i] + step_ticks[i] == now)
+                active.push_back(static_cast<uint32_t>(i));
+
+        // Predict everybody to the block time (Taylor series to the jerk)
+        for (size_t i = 0; i < count; i++) {
+            T h = static_cast<T>((now - ticks[i]) * tick_dt);
+            T h2 = h * h * T(0.5), h3 = h * h * h / T(6);
+            pred_x[i] = pos_x[i] + vel_x[i] * h + acc_x[i] * h2 + jerk_x[i] * h3;
+            pred_y[i] = pos_y[i] + vel_y[i] * h + acc_y[i] * h2 + jerk_y[i] * h3;
+            pred_vx[i] = vel_x[i] + acc_x[i] * h + jerk_x[i] * h2;
+            pred_vy[i] = vel_y[i] + acc_y[i] * h + jerk_y[i] * h2;
+        }
+
+        evaluate(active, mass, count, G, epsilon);
+
+        // Hermite corrector, then the next step of each active body
+        for (uint32_t i : active) {
+            const T h = static_cast<T>(step_ticks[i] * tick_dt);
+            const T a0x = acc_x[i], a0y = acc_y[i], j0x = jerk_x[i], j0y = jerk_y[i];
+            const T a1x = new_acc_x[i], a1y = new_acc_y[i], j1x = new_jerk_x[i], j1y = new_jerk_y[i];
+
+            // Snap and crackle at the start of the step from the Hermite interpolant
+            T snap_x = (-T(6) * (a0x - a1x) - h * (T(4) * j0x + T(2) * j1x)) / (h * h);
+            T snap_y = (-T(6) * (a0y - a1y) - h * (T(4) * j0y + T(2) * j1y)) / (h * h);
+            T crackle_x = (T(12) * (a0x - a1x) + T(6) * h * (j0x + j1x)) / (h * h * h);
+            T crackle_y = (T(12) * (a0y - a1y) + T(6) * h * (j0y + j1y)) / (h * h * h);
+
+            T h3 = h * h * h, h4 = h3 * h, h5 = h4 * h;
+            pos_x[i] = pred_x[i] + snap_x * h4 / T(24) + crackle_x * h5 / T(120);
+            pos_y[i] = pred_y[i] + snap_y * h4 / T(24) + crackle_y * h5 / T(120);
+            vel_x[i] = pred_vx[i] + snap_x * h3 / T(6) + crackle_x * h4 / T(24);
+            vel_y[i] = pred_vy[i] + snap_y * h3 / T(6) + crackle_y * h4 / T(24);
+
+            acc_x[i] = a1x; acc_y[i] = a1y;
+            jerk_x[i] = j1x; jerk_y[i] = j1y;
+            ticks[i] = now;
+
+            // Aarseth criterion with the snap moved to the end of the step
+            snap_x += h * crackle_x;
+            snap_y += h * crackle_y;
+            T a = length(a1x, a1y), j = length(j1x, j1y);
+            T s = length(snap_x, snap_y), c = length(crackle_x, crackle_y);
+            T denominator = j * c + s * s;
+            double wanted = denominator > T(0) ? std::sqrt(accuracy * (a * s + j * j) / denominator) : static_cast<double>(dt);
+            step_ticks[i] = quantize(wanted, tick_dt, step_ticks[i], now);
+        }
+
+        if (now == SPAN) break;
+    }
+
+    // Every step divides SPAN, so all bodies are now synchronized at SPAN
+    std::fill(ticks.begin(), ticks.end(), 0);
+}
+
+// Largest power-of-two step (in ticks) not above 'wanted' that stays on the
+// block grid: halving is always allowed, doubling one level at a time and
+// only at times that are multiples of the doubled step
+template <typename T>
+uint64_t BlockTimestepIntegrator<T>::quantize(double wanted, double tick_dt, uint64_t current, uint64_t tick) const
+{
+    uint64_t steps = current;
+    while (steps > 1 && steps * tick_dt > wanted)
+        steps >>= 1;
+
+    if (steps == current && steps < SPAN && 2 * steps * tick_dt <= wanted && (tick % (2 * steps)) == 0)
+        steps <<= 1;
+
+    return steps;
+}
+
+template <typename T>
+int BlockTimestepIntegrator<T>::get_level(size_t i) const
+{
+    if (i >= step_ticks.size()) return 0;
+
+    int level = 0;
+    for (uint64_t s = step_ticks[i]; s < SPAN; s <<= 1)
+        level++;
+    return level;
+}
+
+// -------------Forces----------------
+// Acceleration and jerk of the targets from the predicted state of all bodies
+template <typename T>
+void BlockTimestepIntegrator<T>::evaluate(const std::vector<uint32_t>& targets, const T* mass, size_t count,
+    T G, T epsilon)
+{
+    const T epsilon2 = epsilon * epsilon;
+
+    auto range = [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            const uint32_t i = targets[t];
+            T ax = T(0), ay = T(0), jx = T(0), jy = T(0);
+
+            for (size_t j = 0; j < count; j++) {
+                T dx = pred_x[j] - pred_x[i];
+                T dy = pred_y[j] - pred_y[i];
+                T dist2 = dx * dx + dy * dy;
+                if (dist2 < epsilon2) continue;
+
+                T dvx = pred_vx[j] - pred_vx[i];
+                T dvy = pred_vy[j] - pred_vy[i];
+
+                T inv_dist2 = T(1) / dist2;
+                T inv_dist3 = mass[j] * inv_dist2 * std::sqrt(inv_dist2);
+                T rv = T(3) * (dx * dvx + dy * dvy) * inv_dist2;
+
+                // a = m r / r^3,  a' = m (v / r^3 - 3 (r.v) r / r^5)
+                ax += dx * inv_dist3;
+                ay += dy * inv_dist3;
+                jx += (dvx - rv * dx) * inv_dist3;
+                jy += (dvy - rv * dy) * inv_dist3;
+            }
+
+            new_acc_x[i] = G * ax; new_acc_y[i] = G * ay;
+            new_jerk_x[i] = G * jx; new_jerk_y[i] = G * jy;
+        }
+    };
+
+    const size_t tasks = (targets.size() + TASK_BODIES - 1) / TASK_BODIES;
+    if (pool && tasks > 1) {
+        pool->parallelTasks(tasks, [&](size_t task, unsigned int) {
+            range(task * TASK_BODIES, std::min(targets.size(), (task + 1) * TASK_BODIES));
+        });
+    }
+    else {
+        range(0, targets.size());
+    }
+
+    body_evaluations += targets.size();
+}
+
+template class BlockTimestepIntegrator<float>;
+template class BlockTimestepIntegrator<double>;
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// 4th-order Hermite integrator with hierarchical block timesteps.
+// Every body has its own step dt / 2^k, chosen with Aarseth's criterion
+//   dt_i = sqrt(eta (|a| |a''| + |a'|^2) / (|a'| |a'''| + |a''|^2))
+// and rounded down to a power of two that keeps it commensurate with the
+// other levels. Only the bodies due at a block time get new forces (from the
+// predicted positions of all bodies); the others are just predicted.
+// Times are integer ticks, so all bodies meet exactly at the end of step().
+// T is the scalar type of the state (float or double).
+template <typename T>
+class BlockTimestepIntegrator
+{
+public:
+    void set_accuracy(float eta) { accuracy = eta; }
+    float get_accuracy() const { return accuracy; }
+
+    // nullptr = evaluate forces on the calling thread
+    void set_thread_pool(ThreadPool* p) { pool = p; }
+
+    // Forget the per-body steps, accelerations and jerks
+    void reset() { initialized = false; }
+
+    // Advance all bodies by dt (the largest block step)
+    void step(T* pos_x, T* pos_y, T* vel_x, T* vel_y, const T* mass, size_t count,
+        T dt, T G, T epsilon);
+
+    // Single-body force evaluations so far
+    unsigned long long get_body_evaluations() const { return body_evaluations; }
+
+    // Current block level of a body (step = dt / 2^level)
+    int get_level(size_t i) const;
+
+private:
+    static const int MAX_LEVEL = 20;
+    static const uint64_t SPAN = uint64_t(1) << MAX_LEVEL;   // ticks per step() call
+
+    float accuracy = 0.02f;
+    float start_accuracy = 0.01f;
+    ThreadPool* pool = nullptr;
+    bool initialized = false;
+    unsigned long long body_evaluations = 0;
+
+    // Per-body Hermite state
+    std::vector<T> acc_x, acc_y;
+    std::vector<T> jerk_x, jerk_y;
+    std::vector<uint64_t> ticks, step_ticks;
+
+    // Predicted state of all bodies at the current block time
+    std::vector<T> pred_x, pred_y, pred_vx, pred_vy;
+    std::vector<uint32_t> active;
+    std::vector<T> new_acc_x, new_acc_y, new_jerk_x, new_jerk_y;
+
+    void evaluate(const std::vector<uint32_t>& targets, const T* mass, size_t count, T G, T epsilon);
+    uint64_t quantize(double wanted, double tick_dt, uint64_t current, uint64_t tick) const;
+};
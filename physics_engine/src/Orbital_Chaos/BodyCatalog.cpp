@@ -0,0 +1,392 @@
+#include "BodyCatalog.h"
+#include "KeplerKernels.h"
+#include "PhysicsWorld.h"
+#include "../Common/MappedFile.h"
+#include "../Common/ThreadPool.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    const char MAGIC[4] = { 'O', 'C', 'A', 'T' };
+    const std::uint32_t VERSION = 1;
+
+    // Work units: bytes of CSV text, rows of elements
+    const size_t CSV_CHUNK_BYTES = 1 << 20;
+    const size_t ROW_CHUNK = 1 << 16;
+    // Rows converted at a time (the catalog columns may be the input)
+    const size_t KEPLER_BLOCK = 1024;
+
+    const float DEGREES = 0.01745329251994329577f;
+
+    const std::uint32_t DEFAULT_COLOR = 0xC8C8C8FF;
+    const float DEFAULT_RADIUS = 2.f;
+
+    enum Column { X, Y, VX, VY, A, E, OMEGA, MEAN_ANOMALY, MASS, RADIUS, COLOR, IGNORED };
+
+    template <typename Job>
+    void for_each_task(ThreadPool* pool, size_t count, const Job& job)
+    {
+        if (pool && count > 1)
+            pool->parallelTasks(count, [&](size_t task, unsigned int) { job(task); });
+        else
+            for (size_t task = 0; task < count; task++) job(task);
+    }
+
+    void throw_first(const std::vector<std::string>& errors)
+    {
+        for (const std::string& error : errors)
+            if (!error.empty()) throw std::runtime_error(error);
+    }
+
+    // -------------CSV----------------
+    const char* line_end(const char* p, const char* end)
+    {
+        const void* newline = std::memchr(p, '\n', static_cast<size_t>(end - p));
+        return newline ? static_cast<const char*>(newline) : end;
+    }
+
+    void trim(const char*& begin, const char*& end)
+    {
+        while (begin < end && (*begin == ' ' || *begin == '\t')) begin++;
+        while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) end--;
+    }
+
+    // Blank and comment lines hold no row
+    bool is_row(const char* begin, const char* end)
+    {
+        trim(begin, end);
+        return begin < end && *begin != '#';
+    }
+
+    Column column_of(const std::string& name)
+    {
+        if (name == "x") return X;
+        if (name == "y") return Y;
+        if (name == "vx") return VX;
+        if (name == "vy") return VY;
+        if (name == "a") return A;
+        if (name == "e") return E;
+        if (name == "omega") return OMEGA;
+        if (name == "M" || name == "mean_anomaly") return MEAN_ANOMALY;
+        if (name == "mass") return MASS;
+        if (name == "radius") return RADIUS;
+        if (name == "color") return COLOR;
+        return IGNORED;
+    }
+
+    bool parse_float(const char* begin, const char* end, float& value)
+    {
+        if (begin < end && *begin == '+') begin++;
+        auto result = std::from_chars(begin, end, value);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    bool parse_color(const char* begin, const char* end, std::uint32_t& value)
+    {
+        if (begin < end && *begin == '#') begin++;
+        const size_t digits = static_cast<size_t>(end - begin);
+        if (digits != 6 && digits != 8) return false;
+
+        auto result = std::from_chars(begin, end, value, 16);
+        if (result.ec != std::errc() || result.ptr != end) return false;
+        if (digits == 6) value = (value << 8) | 0xFF;
+        return true;
+    }
+}
+
+// -------------Loading----------------
+void BodyCatalog::load(const std::string& path, const CelestialBody* primary, ThreadPool* pool)
+{
+    clear();
+    MappedFile file(path);
+
+    try {
+        if (file.size() >= sizeof(MAGIC) && std::memcmp(file.data(), MAGIC, sizeof(MAGIC)) == 0)
+            load_binary(file.data(), file.size(), primary, pool);
+        else
+            load_csv(file.data(), file.data() + file.size(), primary, pool);
+    }
+    catch (const std::runtime_error& error) {
+        clear();
+        throw std::runtime_error(path + ": " + error.what());
+    }
+}
+
+void BodyCatalog::load_csv(const char* begin, const char* end, const CelestialBody* primary, ThreadPool* pool)
+{
+    // Header: the first line that is not blank or a comment
+    const char* p = begin;
+    while (p < end && !is_row(p, line_end(p, end)))
+        p = line_end(p, end) + 1;
+    if (p >= end) throw std::runtime_error("no header row");
+
+    std::vector<Column> columns;
+    const char* header_end = line_end(p, end);
+    while (true) {
+        const char* comma = std::find(p, header_end, ',');
+        const char* name_begin = p;
+        const char* name_end = comma;
+        trim(name_begin, name_end);
+        columns.push_back(column_of(std::string(name_begin, name_end)));
+        if (comma == header_end) break;
+        p = comma + 1;
+    }
+    const char* body = std::min(header_end + 1, end);
+
+    bool present[IGNORED] = {};
+    for (Column c : columns)
+        if (c != IGNORED) present[c] = true;
+
+    Kind kind;
+    if (present[X] && present[Y] && present[VX] && present[VY])
+        kind = Kind::States;
+    else if (present[A] && present[E] && present[OMEGA] && present[MEAN_ANOMALY])
+        kind = Kind::Elements;
+    else
+        throw std::runtime_error("needs columns x, y, vx, vy or a, e, omega, M");
+    if (kind == Kind::Elements && !primary) throw std::runtime_error("elements without a primary");
+
+    // Chunks of whole lines, about CSV_CHUNK_BYTES each; count the rows of
+    // every chunk first so each one parses straight into its place
+    std::vector<const char*> cuts{ body };
+    for (const char* cut = body + CSV_CHUNK_BYTES; cut < end; cut += CSV_CHUNK_BYTES) {
+        const char* newline = line_end(cut, end);
+        if (newline + 1 >= end) break;
+        cut = newline + 1;
+        cuts.push_back(cut);
+    }
+    cuts.push_back(end);
+    const size_t chunks = cuts.size() - 1;
+
+    std::vector<size_t> first_row(chunks + 1, 0);
+    for_each_task(pool, chunks, [&](size_t c) {
+        size_t rows = 0;
+        for (const char* line = cuts[c]; line < cuts[c + 1];) {
+            const char* next = line_end(line, cuts[c + 1]);
+            if (is_row(line, next)) rows++;
+            line = next + 1;
+        }
+        first_row[c + 1] = rows;
+    });
+    for (size_t c = 0; c < chunks; c++)
+        first_row[c + 1] += first_row[c];
+    resize(first_row[chunks]);
+
+    // Elements are parsed into the state columns (a into x, e into y,
+    // omega into vx, M into vy) and converted in place afterwards
+    float* targets[IGNORED] = {};
+    targets[X] = targets[A] = pos_x.data();
+    targets[Y] = targets[E] = pos_y.data();
+    targets[VX] = targets[OMEGA] = vel_x.data();
+    targets[VY] = targets[MEAN_ANOMALY] = vel_y.data();
+    targets[MASS] = mass.data();
+    targets[RADIUS] = radius.data();
+    const bool wanted[IGNORED] = {
+        kind == Kind::States, kind == Kind::States, kind == Kind::States, kind == Kind::States,
+        kind == Kind::Elements, kind == Kind::Elements, kind == Kind::Elements, kind == Kind::Elements,
+        true, true, true };
+
+    std::vector<std::string> errors(chunks);
+    for_each_task(pool, chunks, [&](size_t c) {
+        size_t row = first_row[c];
+        for (const char* line = cuts[c]; line < cuts[c + 1]; ) {
+            const char* next = line_end(line, cuts[c + 1]);
+            if (!is_row(line, next)) {
+                line = next + 1;
+                continue;
+            }
+
+            mass[row] = 0.f;
+            radius[row] = DEFAULT_RADIUS;
+            color[row] = DEFAULT_COLOR;
+
+            const char* field = line;
+            size_t filled = 0;
+            for (size_t k = 0; k < columns.size(); k++) {
+                if (field > next) break;
+                const char* comma = std::find(field, next, ',');
+                const char* field_begin = field;
+                const char* field_end = comma;
+                trim(field_begin, field_end);
+                field = comma + 1;
+                filled++;
+
+                const Column column = columns[k];
+                if (column == IGNORED || !wanted[column]) continue;
+                // Optional columns may be left empty
+                if (field_begin == field_end && column >= MASS) continue;
+
+                bool ok;
+                if (column == COLOR) {
+                    ok = parse_color(field_begin, field_end, color[row]);
+                }
+                else {
+                    float value;
+                    ok = parse_float(field_begin, field_end, value);
+                    if (column == OMEGA || column == MEAN_ANOMALY) value *= DEGREES;
+                    targets[column][row] = value;
+                }
+                if (!ok) {
+                    errors[c] = "row " + std::to_string(row + 1) + ": bad value '" +
+                        std::string(field_begin, field_end) + "'";
+                    return;
+                }
+            }
+            if (filled < columns.size()) {
+                errors[c] = "row " + std::to_string(row + 1) + ": expected " +
+                    std::to_string(columns.size()) + " columns";
+                return;
+            }
+
+            row++;
+            line = next + 1;
+        }
+    });
+    throw_first(errors);
+
+    if (kind == Kind::Elements) {
+        std::vector<std::string> invalid((size() + ROW_CHUNK - 1) / ROW_CHUNK);
+        for_each_task(pool, invalid.size(), [&](size_t c) {
+            const size_t first = c * ROW_CHUNK, last = std::min(size(), first + ROW_CHUNK);
+            for (size_t i = first; i < last; i++)
+                if (!(pos_x[i] > 0.f) || !(pos_y[i] >= 0.f && pos_y[i] < 1.f)) {
+                    invalid[c] = "row " + std::to_string(i + 1) + ": not an elliptic orbit (a > 0, 0 <= e < 1)";
+                    return;
+                }
+            convert_elements(pos_x.data(), pos_y.data(), vel_x.data(), vel_y.data(), first, last, *primary);
+        });
+        throw_first(invalid);
+    }
+}
+
+void BodyCatalog::load_binary(const char* data, size_t bytes, const CelestialBody* primary, ThreadPool* pool)
+{
+    Header header;
+    if (bytes < sizeof(header)) throw std::runtime_error("truncated header");
+    std::memcpy(&header, data, sizeof(header));
+
+    if (header.version != VERSION) throw std::runtime_error("unsupported version " + std::to_string(header.version));
+    if (header.kind != Kind::States && header.kind != Kind::Elements) throw std::runtime_error("unknown kind");
+    if (header.kind == Kind::Elements && !primary) throw std::runtime_error("elements without a primary");
+
+    // 6 float columns and the colors
+    const size_t row_bytes = 6 * sizeof(float) + sizeof(std::uint32_t);
+    if (header.count > (bytes - sizeof(header)) / row_bytes) throw std::runtime_error("truncated columns");
+    const size_t n = static_cast<size_t>(header.count);
+
+    // The mapping is page aligned and the header a multiple of 4 bytes
+    const float* columns = reinterpret_cast<const float*>(data + sizeof(header));
+    const float* c0 = columns;
+    const float* c1 = columns + n;
+    const float* c2 = columns + 2 * n;
+    const float* c3 = columns + 3 * n;
+    const float* in_mass = columns + 4 * n;
+    const float* in_radius = columns + 5 * n;
+    const std::uint32_t* in_color = reinterpret_cast<const std::uint32_t*>(columns + 6 * n);
+
+    resize(n);
+
+    std::vector<std::string> errors((n + ROW_CHUNK - 1) / ROW_CHUNK);
+    for_each_task(pool, errors.size(), [&](size_t c) {
+        const size_t first = c * ROW_CHUNK, last = std::min(n, first + ROW_CHUNK);
+        const size_t count = last - first;
+
+        if (header.kind == Kind::States) {
+            std::memcpy(pos_x.data() + first, c0 + first, count * sizeof(float));
+            std::memcpy(pos_y.data() + first, c1 + first, count * sizeof(float));
+            std::memcpy(vel_x.data() + first, c2 + first, count * sizeof(float));
+            std::memcpy(vel_y.data() + first, c3 + first, count * sizeof(float));
+        }
+        else {
+            for (size_t i = first; i < last; i++)
+                if (!(c0[i] > 0.f) || !(c1[i] >= 0.f && c1[i] < 1.f)) {
+                    errors[c] = "row " + std::to_string(i + 1) + ": not an elliptic orbit (a > 0, 0 <= e < 1)";
+                    return;
+                }
+            convert_elements(c0, c1, c2, c3, first, last, *primary);
+        }
+        std::memcpy(mass.data() + first, in_mass + first, count * sizeof(float));
+        std::memcpy(radius.data() + first, in_radius + first, count * sizeof(float));
+        std::memcpy(color.data() + first, in_color + first, count * sizeof(std::uint32_t));
+    });
+    throw_first(errors);
+}
+
+void BodyCatalog::convert_elements(const float* a, const float* e, const float* omega, const float* mean_anomaly,
+    size_t begin, size_t end, const CelestialBody& primary)
+{
+    const float mu = PhysicsConstants::G * primary.get_mass();
+    const sf::Vector2f origin = primary.get_position();
+    const sf::Vector2f drift = primary.get_velocity();
+
+    float x[KEPLER_BLOCK], y[KEPLER_BLOCK], vx[KEPLER_BLOCK], vy[KEPLER_BLOCK];
+    for (size_t block = begin; block < end; block += KEPLER_BLOCK) {
+        const size_t count = std::min(KEPLER_BLOCK, end - block);
+        KeplerKernels::elements_to_states(a + block, e + block, omega + block, mean_anomaly + block,
+            count, mu, x, y, vx, vy);
+
+        for (size_t k = 0; k < count; k++) {
+            pos_x[block + k] = origin.x + x[k];
+            pos_y[block + k] = origin.y + y[k];
+            vel_x[block + k] = drift.x + vx[k];
+            vel_y[block + k] = drift.y + vy[k];
+        }
+    }
+}
+
+void BodyCatalog::resize(size_t count)
+{
+    // Default-initialized: the parsing threads touch the pages first
+    pos_x.resize(count);
+    pos_y.resize(count);
+    vel_x.resize(count);
+    vel_y.resize(count);
+    mass.resize(count);
+    radius.resize(count);
+    color.resize(count);
+}
+
+void BodyCatalog::clear()
+{
+    resize(0);
+}
+
+// -------------Saving----------------
+void BodyCatalog::save(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("cannot write " + path);
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.kind = Kind::States;
+    header.reserved = 0;
+    header.count = size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    const size_t bytes = size() * sizeof(float);
+    for (const NumaVector<float>* column : { &pos_x, &pos_y, &vel_x, &vel_y, &mass, &radius })
+        file.write(reinterpret_cast<const char*>(column->data()), static_cast<std::streamsize>(bytes));
+    file.write(reinterpret_cast<const char*>(color.data()), static_cast<std::streamsize>(size() * sizeof(std::uint32_t)));
+
+    if (!file) throw std::runtime_error("cannot write " + path);
+}
+
+// -------------Conversion----------------
+void BodyCatalog::append_bodies(std::vector<CelestialBody>& bodies) const
+{
+    for (size_t i = 0; i < size(); i++) {
+        if (mass[i] <= 0.f) continue;
+
+        CelestialBody body(get_position(i), get_velocity(i));
+        body.set_mass(mass[i]);
+        body.set_radius(radius[i]);
+        body.set_color(get_color(i));
+        bodies.push_back(body);
+    }
+}
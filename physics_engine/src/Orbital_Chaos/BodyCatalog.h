@@ -0,0 +1,85 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CelestialBody.h"
+#include "TestParticles.h"
+#include "../Common/NumaAllocator.h"
+
+class ThreadPool;
+
+// Body catalogs (planets, asteroids, debris) read from a file, kept as
+// structure-of-arrays state vectors in world units.
+//
+// Two formats, told apart by their first bytes:
+//  - CSV: '#' comment lines, then a header naming the columns, one row per
+//    body. Either x, y, vx, vy (absolute state) or a, e, omega, M (elliptic
+//    elements around the primary, angles in degrees) are required; mass,
+//    radius and color (hex RRGGBB or RRGGBBAA) are optional, other columns
+//    are ignored.
+//  - Binary: a Header, then count floats per column: the four state or
+//    element columns (angles in radians), mass, radius, and count packed
+//    RGBA colors, in native byte order.
+// Files are memory mapped and parsed / converted in chunks across the
+// thread pool; elements go through the batch Kepler solver (KeplerKernels).
+class BodyCatalog
+{
+public:
+    enum class Kind : std::uint32_t { States = 0, Elements = 1 };
+
+    struct Header {
+        char magic[4];          // "OCAT"
+        std::uint32_t version;
+        Kind kind;
+        std::uint32_t reserved;
+        std::uint64_t count;
+    };
+
+    // Replaces the contents. Elements need the primary (its position,
+    // velocity and mass); pool = nullptr parses on the calling thread.
+    // Throws std::runtime_error on unreadable or malformed files
+    void load(const std::string& path, const CelestialBody* primary = nullptr, ThreadPool* pool = nullptr);
+    // Binary, as state vectors
+    void save(const std::string& path) const;
+
+    void clear();
+    size_t size() const { return pos_x.size(); }
+
+    sf::Vector2f get_position(size_t i) const { return { pos_x[i], pos_y[i] }; }
+    sf::Vector2f get_velocity(size_t i) const { return { vel_x[i], vel_y[i] }; }
+    float get_mass(size_t i) const { return mass[i]; }
+    float get_radius(size_t i) const { return radius[i]; }
+    sf::Color get_color(size_t i) const { return sf::Color(color[i]); }
+
+    // Rows with mass become bodies, massless rows test particles
+    void append_bodies(std::vector<CelestialBody>& bodies) const;
+    template <typename T>
+    void append_particles(TestParticles<T>& particles) const;
+
+private:
+    NumaVector<float> pos_x, pos_y;
+    NumaVector<float> vel_x, vel_y;
+    NumaVector<float> mass, radius;
+    NumaVector<std::uint32_t> color;
+
+    void resize(size_t count);
+    void load_csv(const char* begin, const char* end, const CelestialBody* primary, ThreadPool* pool);
+    void load_binary(const char* data, size_t bytes, const CelestialBody* primary, ThreadPool* pool);
+    // Rows [begin, end): elements a, e, omega, M (radians) to states
+    void convert_elements(const float* a, const float* e, const float* omega, const float* mean_anomaly,
+        size_t begin, size_t end, const CelestialBody& primary);
+};
+
+template <typename T>
+void BodyCatalog::append_particles(TestParticles<T>& particles) const
+{
+    size_t count = 0;
+    for (size_t i = 0; i < size(); i++)
+        if (mass[i] <= 0.f) count++;
+
+    particles.reserve(particles.size() + count);
+    for (size_t i = 0; i < size(); i++)
+        if (mass[i] <= 0.f) particles.add(get_position(i), get_velocity(i));
+}
@@ -16,6 +16,7 @@ public:
     sf::Vector2f get_velocity() const { return velocity; }
     float get_mass() const { return mass; }
     sf::Color get_color() const { return body.getFillColor(); }
+    float get_radius() const { return body.getRadius(); }
 
     // Setters
     void set_position(sf::Vector2f p) {
@@ -0,0 +1,240 @@
+#include "GravityKernels.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define GRAVITY_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define GRAVITY_TARGET(isa)
+#else
+#define GRAVITY_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace
+{
+    // Sources per tile: x, y, m of 2048 bodies = 24 KB, stays in L1
+    const size_t TILE = 2048;
+
+    // -------------Scalar----------------
+    void scalar_range(const float* x, const float* y, const float* m, size_t n,
+        size_t begin, size_t end, float G, float epsilon, float* ax, float* ay)
+    {
+        const float epsilon2 = epsilon * epsilon;
+        for (size_t i = begin; i < end; i++) {
+            float axi = 0.f, ayi = 0.f;
+            for (size_t j = 0; j < n; j++) {
+                float dx = x[j] - x[i];
+                float dy = y[j] - y[i];
+                float dist2 = dx * dx + dy * dy;
+                if (dist2 < epsilon2) continue;
+
+                float inv_dist = 1.f / std::sqrt(dist2);
+                float s = m[j] * inv_dist * inv_dist * inv_dist;
+                axi += dx * s;
+                ayi += dy * s;
+            }
+            ax[i] = G * axi;
+            ay[i] = G * ayi;
+        }
+    }
+
+#if GRAVITY_X86
+    // -------------AVX2 (8 lanes)----------------
+    GRAVITY_TARGET("avx2,fma")
+    void avx2_range(const float* x, const float* y, const float* m, size_t n,
+        size_t begin, size_t end, float G, float epsilon, float* ax, float* ay)
+    {
+        const __m256 epsilon2 = _mm256_set1_ps(epsilon * epsilon);
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256 three_halves = _mm256_set1_ps(1.5f);
+        const __m256 g = _mm256_set1_ps(G);
+
+        // Body of one source against one target vector
+        auto interact = [&](__m256 xi, __m256 yi, __m256 xj, __m256 yj, __m256 mj, __m256& axi, __m256& ayi)
+            GRAVITY_TARGET("avx2,fma")
+        {
+            __m256 dx = _mm256_sub_ps(xj, xi);
+            __m256 dy = _mm256_sub_ps(yj, yi);
+            __m256 dist2 = _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx));
+
+            // rsqrt (12 bits) + one Newton step: r * (1.5 - 0.5 d r^2)
+            __m256 r = _mm256_rsqrt_ps(dist2);
+            __m256 hd = _mm256_mul_ps(half, dist2);
+            r = _mm256_mul_ps(r, _mm256_fnmadd_ps(hd, _mm256_mul_ps(r, r), three_halves));
+
+            __m256 s = _mm256_mul_ps(mj, _mm256_mul_ps(r, _mm256_mul_ps(r, r)));
+            s = _mm256_and_ps(s, _mm256_cmp_ps(dist2, epsilon2, _CMP_GE_OQ));
+
+            axi = _mm256_fmadd_ps(dx, s, axi);
+            ayi = _mm256_fmadd_ps(dy, s, ayi);
+        };
+
+        const size_t vector_end = begin + (end - begin) / 16 * 16;
+        for (size_t i = begin; i < vector_end; i++) {
+            ax[i] = 0.f;
+            ay[i] = 0.f;
+        }
+
+        // Source tiles outside, so every tile is reused by all target blocks
+        for (size_t tile = 0; tile < n; tile += TILE) {
+            const size_t tile_end = tile + TILE < n ? tile + TILE : n;
+
+            for (size_t i = begin; i < vector_end; i += 16) {
+                __m256 xi0 = _mm256_loadu_ps(x + i), xi1 = _mm256_loadu_ps(x + i + 8);
+                __m256 yi0 = _mm256_loadu_ps(y + i), yi1 = _mm256_loadu_ps(y + i + 8);
+                __m256 ax0 = _mm256_loadu_ps(ax + i), ax1 = _mm256_loadu_ps(ax + i + 8);
+                __m256 ay0 = _mm256_loadu_ps(ay + i), ay1 = _mm256_loadu_ps(ay + i + 8);
+
+                for (size_t j = tile; j < tile_end; j++) {
+                    __m256 xj = _mm256_broadcast_ss(x + j);
+                    __m256 yj = _mm256_broadcast_ss(y + j);
+                    __m256 mj = _mm256_broadcast_ss(m + j);
+                    interact(xi0, yi0, xj, yj, mj, ax0, ay0);
+                    interact(xi1, yi1, xj, yj, mj, ax1, ay1);
+                }
+
+                _mm256_storeu_ps(ax + i, ax0);
+                _mm256_storeu_ps(ax + i + 8, ax1);
+                _mm256_storeu_ps(ay + i, ay0);
+                _mm256_storeu_ps(ay + i + 8, ay1);
+            }
+        }
+
+        for (size_t i = begin; i < vector_end; i += 8) {
+            _mm256_storeu_ps(ax + i, _mm256_mul_ps(g, _mm256_loadu_ps(ax + i)));
+            _mm256_storeu_ps(ay + i, _mm256_mul_ps(g, _mm256_loadu_ps(ay + i)));
+        }
+
+        scalar_range(x, y, m, n, vector_end, end, G, epsilon, ax, ay);
+    }
+
+    // -------------AVX-512 (16 lanes)----------------
+    GRAVITY_TARGET("avx512f")
+    void avx512_range(const float* x, const float* y, const float* m, size_t n,
+        size_t begin, size_t end, float G, float epsilon, float* ax, float* ay)
+    {
+        const __m512 epsilon2 = _mm512_set1_ps(epsilon * epsilon);
+        const __m512 half = _mm512_set1_ps(0.5f);
+        const __m512 three_halves = _mm512_set1_ps(1.5f);
+        const __m512 g = _mm512_set1_ps(G);
+
+        auto interact = [&](__m512 xi, __m512 yi, __m512 xj, __m512 yj, __m512 mj, __m512& axi, __m512& ayi)
+            GRAVITY_TARGET("avx512f")
+        {
+            __m512 dx = _mm512_sub_ps(xj, xi);
+            __m512 dy = _mm512_sub_ps(yj, yi);
+            __m512 dist2 = _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dx, dx));
+            __mmask16 valid = _mm512_cmp_ps_mask(dist2, epsilon2, _CMP_GE_OQ);
+
+            // rsqrt14 + one Newton step is accurate to float precision;
+            // skipped lanes get r = 0 and contribute nothing
+            __m512 r = _mm512_maskz_rsqrt14_ps(valid, dist2);
+            __m512 hd = _mm512_mul_ps(half, dist2);
+            r = _mm512_mul_ps(r, _mm512_fnmadd_ps(hd, _mm512_mul_ps(r, r), three_halves));
+
+            __m512 s = _mm512_mul_ps(mj, _mm512_mul_ps(r, _mm512_mul_ps(r, r)));
+
+            axi = _mm512_fmadd_ps(dx, s, axi);
+            ayi = _mm512_fmadd_ps(dy, s, ayi);
+        };
+
+        const size_t vector_end = begin + (end - begin) / 32 * 32;
+        for (size_t i = begin; i < vector_end; i++) {
+            ax[i] = 0.f;
+            ay[i] = 0.f;
+        }
+
+        for (size_t tile = 0; tile < n; tile += TILE) {
+            const size_t tile_end = tile + TILE < n ? tile + TILE : n;
+
+            for (size_t i = begin; i < vector_end; i += 32) {
+                __m512 xi0 = _mm512_loadu_ps(x + i), xi1 = _mm512_loadu_ps(x + i + 16);
+                __m512 yi0 = _mm512_loadu_ps(y + i), yi1 = _mm512_loadu_ps(y + i + 16);
+                __m512 ax0 = _mm512_loadu_ps(ax + i), ax1 = _mm512_loadu_ps(ax + i + 16);
+                __m512 ay0 = _mm512_loadu_ps(ay + i), ay1 = _mm512_loadu_ps(ay + i + 16);
+
+                for (size_t j = tile; j < tile_end; j++) {
+                    __m512 xj = _mm512_set1_ps(x[j]);
+                    __m512 yj = _mm512_set1_ps(y[j]);
+                    __m512 mj = _mm512_set1_ps(m[j]);
+                    interact(xi0, yi0, xj, yj, mj, ax0, ay0);
+                    interact(xi1, yi1, xj, yj, mj, ax1, ay1);
+                }
+
+                _mm512_storeu_ps(ax + i, ax0);
+                _mm512_storeu_ps(ax + i + 16, ax1);
+                _mm512_storeu_ps(ay + i, ay0);
+                _mm512_storeu_ps(ay + i + 16, ay1);
+            }
+        }
+
+        for (size_t i = begin; i < vector_end; i += 16) {
+            _mm512_storeu_ps(ax + i, _mm512_mul_ps(g, _mm512_loadu_ps(ax + i)));
+            _mm512_storeu_ps(ay + i, _mm512_mul_ps(g, _mm512_loadu_ps(ay + i)));
+        }
+
+        scalar_range(x, y, m, n, vector_end, end, G, epsilon, ax, ay);
+    }
+#endif
+}
+
+namespace GravityKernels
+{
+    // -------------Dispatch----------------
+    Isa detect_isa()
+    {
+        static const Isa best = []
+        {
+#if GRAVITY_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool fma = (info[2] & (1 << 12)) != 0;
+            if (!osxsave) return Isa::Scalar;
+
+            // OS must save the YMM (and for AVX-512 the ZMM/opmask) state
+            const unsigned long long xcr0 = _xgetbv(0);
+            __cpuidex(info, 7, 0);
+            if ((xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16))) return Isa::AVX512;
+            if ((xcr0 & 0x6) == 0x6 && (info[1] & (1 << 5)) && fma) return Isa::AVX2;
+#else
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f")) return Isa::AVX512;
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return Isa::AVX2;
+#endif
+#endif
+            return Isa::Scalar;
+        }();
+        return best;
+    }
+
+    const char* isa_name(Isa isa)
+    {
+        switch (isa) {
+        case Isa::AVX512: return "AVX-512";
+        case Isa::AVX2: return "AVX2";
+        default: return "scalar";
+        }
+    }
+
+    void direct_accelerations(const float* x, const float* y, const float* m, size_t n,
+        size_t begin, size_t end, float G, float epsilon, float* ax, float* ay)
+    {
+        direct_accelerations(detect_isa(), x, y, m, n, begin, end, G, epsilon, ax, ay);
+    }
+
+    void direct_accelerations(Isa isa, const float* x, const float* y, const float* m, size_t n,
+        size_t begin, size_t end, float G, float epsilon, float* ax, float* ay)
+    {
+#if GRAVITY_X86
+        if (isa == Isa::AVX512) { avx512_range(x, y, m, n, begin, end, G, epsilon, ax, ay); return; }
+        if (isa == Isa::AVX2) { avx2_range(x, y, m, n, begin, end, G, epsilon, ax, ay); return; }
+#else
+        (void)isa;
+#endif
+        scalar_range(x, y, m, n, begin, end, G, epsilon, ax, ay);
+    }
+}
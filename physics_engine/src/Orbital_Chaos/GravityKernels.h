@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+
+// Direct-summation gravity kernels on structure-of-arrays input.
+// Every target i sums all sources j (sources closer than epsilon, including
+// itself, are skipped). The SIMD versions keep 2 vectors of targets in
+// registers, broadcast one source at a time from an L1-sized tile, and use
+// rsqrt refined by one Newton step instead of sqrt + divide.
+// The instruction set is picked at run time; the scalar version always works.
+namespace GravityKernels
+{
+    enum class Isa { Scalar, AVX2, AVX512 };
+
+    // Best instruction set supported by this CPU and OS (detected once)
+    Isa detect_isa();
+    const char* isa_name(Isa isa);
+
+    // Accelerations of targets [begin, end) from all n sources
+    void direct_accelerations(const float* x, const float* y, const float* m, size_t n,
+        size_t begin, size_t end, float G, float epsilon, float* ax, float* ay);
+
+    // Same with an explicit instruction set (must be supported)
+    void direct_accelerations(Isa isa, const float* x, const float* y, const float* m, size_t n,
+        size_t begin, size_t end, float G, float epsilon, float* ax, float* ay);
+}
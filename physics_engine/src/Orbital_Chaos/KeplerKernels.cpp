@@ -0,0 +1,266 @@
+#include "KeplerKernels.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define KEPLER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define KEPLER_TARGET(isa)
+#else
+#define KEPLER_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace
+{
+    const int ITERATIONS = 6;
+
+    const float TWO_PI = 6.28318530717958647692f;
+    const float INV_TWO_PI = 0.15915494309189533577f;
+    const float TWO_OVER_PI = 0.63661977236758134308f;
+
+    // 2 pi and pi / 2 in parts whose multiples by small integers are exact
+    // (Cody-Waite reduction)
+    const float TWO_PI_HI = 6.28125f;
+    const float TWO_PI_LO = 1.9353071795864769e-3f;
+    const float PI_2_A = 1.5703125f;
+    const float PI_2_B = 4.837512969970703125e-4f;
+    const float PI_2_C = 7.54978995489188216e-8f;
+
+    // Cephes minimax polynomials on [-pi/4, pi/4]
+    const float S1 = -1.6666654611e-1f, S2 = 8.3321608736e-3f, S3 = -1.9515295891e-4f;
+    const float C1 = 4.166664568298827e-2f, C2 = -1.388731625493765e-3f, C3 = 2.443315711809948e-5f;
+
+    // Danby's starting value; sin M has the sign of M on [-pi, pi]
+    const float DANBY = 0.85f;
+
+    // -------------Scalar----------------
+    void scalar_range(const float* a, const float* e, const float* omega, const float* mean_anomaly,
+        size_t begin, size_t end, float mu, float* x, float* y, float* vx, float* vy)
+    {
+        for (size_t i = begin; i < end; i++) {
+            const float ecc = e[i];
+            float m = mean_anomaly[i];
+            const float k = std::nearbyint(m * INV_TWO_PI);
+            m = (m - k * TWO_PI_HI) - k * TWO_PI_LO;
+
+            float E = m + (m < 0.f ? -DANBY : DANBY) * ecc;
+            for (int it = 0; it < ITERATIONS; it++)
+                E -= (E - ecc * std::sin(E) - m) / (1.f - ecc * std::cos(E));
+
+            const float s = std::sin(E), c = std::cos(E);
+            const float b = a[i] * std::sqrt(1.f - ecc * ecc);
+            const float n = std::sqrt(mu / (a[i] * a[i] * a[i]));
+            const float d = 1.f - ecc * c;
+
+            // Perifocal frame (y up), turned by omega, then flipped to screen y
+            const float px = a[i] * (c - ecc), py = b * s;
+            const float pvx = -a[i] * n * s / d, pvy = b * n * c / d;
+            const float so = std::sin(omega[i]), co = std::cos(omega[i]);
+
+            x[i] = px * co - py * so;
+            y[i] = -(px * so + py * co);
+            vx[i] = pvx * co - pvy * so;
+            vy[i] = -(pvx * so + pvy * co);
+        }
+    }
+
+#if KEPLER_X86
+    // -------------AVX2 (8 lanes)----------------
+    KEPLER_TARGET("avx2,fma")
+    inline void sincos_avx2(__m256 v, __m256& sin_v, __m256& cos_v)
+    {
+        // v = q pi/2 + r, |r| <= pi/4
+        __m256 q = _mm256_round_ps(_mm256_mul_ps(v, _mm256_set1_ps(TWO_OVER_PI)),
+            _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256 r = _mm256_fnmadd_ps(q, _mm256_set1_ps(PI_2_A), v);
+        r = _mm256_fnmadd_ps(q, _mm256_set1_ps(PI_2_B), r);
+        r = _mm256_fnmadd_ps(q, _mm256_set1_ps(PI_2_C), r);
+        __m256i quadrant = _mm256_cvtps_epi32(q);
+
+        __m256 r2 = _mm256_mul_ps(r, r);
+        __m256 ps = _mm256_fmadd_ps(r2, _mm256_set1_ps(S3), _mm256_set1_ps(S2));
+        ps = _mm256_fmadd_ps(ps, r2, _mm256_set1_ps(S1));
+        __m256 sin_r = _mm256_fmadd_ps(_mm256_mul_ps(ps, r2), r, r);
+        __m256 pc = _mm256_fmadd_ps(r2, _mm256_set1_ps(C3), _mm256_set1_ps(C2));
+        pc = _mm256_fmadd_ps(pc, r2, _mm256_set1_ps(C1));
+        __m256 cos_r = _mm256_fmadd_ps(_mm256_mul_ps(pc, r2), r2,
+            _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), r2, _mm256_set1_ps(1.f)));
+
+        // Odd quadrants swap sine and cosine; bit 1 of q (of q + 1) flips the sine (cosine)
+        const __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2);
+        __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, one), one));
+        __m256 sin_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, two), 30));
+        __m256 cos_sign = _mm256_castsi256_ps(_mm256_slli_epi32(
+            _mm256_and_si256(_mm256_add_epi32(quadrant, one), two), 30));
+
+        sin_v = _mm256_xor_ps(_mm256_blendv_ps(sin_r, cos_r, swap), sin_sign);
+        cos_v = _mm256_xor_ps(_mm256_blendv_ps(cos_r, sin_r, swap), cos_sign);
+    }
+
+    KEPLER_TARGET("avx2,fma")
+    void avx2_range(const float* a, const float* e, const float* omega, const float* mean_anomaly,
+        size_t begin, size_t end, float mu, float* x, float* y, float* vx, float* vy)
+    {
+        const __m256 one = _mm256_set1_ps(1.f);
+        const __m256 sign_bit = _mm256_set1_ps(-0.f);
+        const __m256 vmu = _mm256_set1_ps(mu);
+
+        const size_t vector_end = begin + (end - begin) / 8 * 8;
+        for (size_t i = begin; i < vector_end; i += 8) {
+            const __m256 ecc = _mm256_loadu_ps(e + i);
+            const __m256 ai = _mm256_loadu_ps(a + i);
+
+            __m256 m = _mm256_loadu_ps(mean_anomaly + i);
+            __m256 k = _mm256_round_ps(_mm256_mul_ps(m, _mm256_set1_ps(INV_TWO_PI)),
+                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            m = _mm256_fnmadd_ps(k, _mm256_set1_ps(TWO_PI_HI), m);
+            m = _mm256_fnmadd_ps(k, _mm256_set1_ps(TWO_PI_LO), m);
+
+            // E0 = m + 0.85 e sign(m)
+            __m256 start = _mm256_or_ps(_mm256_and_ps(m, sign_bit), _mm256_mul_ps(_mm256_set1_ps(DANBY), ecc));
+            __m256 E = _mm256_add_ps(m, start);
+
+            __m256 s, c;
+            for (int it = 0; it < ITERATIONS; it++) {
+                sincos_avx2(E, s, c);
+                __m256 f = _mm256_sub_ps(_mm256_fnmadd_ps(ecc, s, E), m);
+                __m256 df = _mm256_fnmadd_ps(ecc, c, one);
+                E = _mm256_sub_ps(E, _mm256_div_ps(f, df));
+            }
+            sincos_avx2(E, s, c);
+
+            __m256 b = _mm256_mul_ps(ai, _mm256_sqrt_ps(_mm256_fnmadd_ps(ecc, ecc, one)));
+            __m256 n = _mm256_sqrt_ps(_mm256_div_ps(vmu, _mm256_mul_ps(ai, _mm256_mul_ps(ai, ai))));
+            __m256 speed = _mm256_div_ps(n, _mm256_fnmadd_ps(ecc, c, one));
+
+            __m256 px = _mm256_mul_ps(ai, _mm256_sub_ps(c, ecc));
+            __m256 py = _mm256_mul_ps(b, s);
+            __m256 pvx = _mm256_xor_ps(_mm256_mul_ps(_mm256_mul_ps(ai, speed), s), sign_bit);
+            __m256 pvy = _mm256_mul_ps(_mm256_mul_ps(b, speed), c);
+
+            __m256 so, co;
+            sincos_avx2(_mm256_loadu_ps(omega + i), so, co);
+
+            _mm256_storeu_ps(x + i, _mm256_fmsub_ps(px, co, _mm256_mul_ps(py, so)));
+            _mm256_storeu_ps(y + i, _mm256_xor_ps(_mm256_fmadd_ps(px, so, _mm256_mul_ps(py, co)), sign_bit));
+            _mm256_storeu_ps(vx + i, _mm256_fmsub_ps(pvx, co, _mm256_mul_ps(pvy, so)));
+            _mm256_storeu_ps(vy + i, _mm256_xor_ps(_mm256_fmadd_ps(pvx, so, _mm256_mul_ps(pvy, co)), sign_bit));
+        }
+
+        scalar_range(a, e, omega, mean_anomaly, vector_end, end, mu, x, y, vx, vy);
+    }
+
+    // -------------AVX-512 (16 lanes)----------------
+    KEPLER_TARGET("avx512f")
+    inline __m512 xor_avx512(__m512 v, __m512 bits)
+    {
+        // _mm512_xor_ps needs AVX512DQ
+        return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(v), _mm512_castps_si512(bits)));
+    }
+
+    KEPLER_TARGET("avx512f")
+    inline void sincos_avx512(__m512 v, __m512& sin_v, __m512& cos_v)
+    {
+        __m512 q = _mm512_roundscale_ps(_mm512_mul_ps(v, _mm512_set1_ps(TWO_OVER_PI)),
+            _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m512 r = _mm512_fnmadd_ps(q, _mm512_set1_ps(PI_2_A), v);
+        r = _mm512_fnmadd_ps(q, _mm512_set1_ps(PI_2_B), r);
+        r = _mm512_fnmadd_ps(q, _mm512_set1_ps(PI_2_C), r);
+        __m512i quadrant = _mm512_cvtps_epi32(q);
+
+        __m512 r2 = _mm512_mul_ps(r, r);
+        __m512 ps = _mm512_fmadd_ps(r2, _mm512_set1_ps(S3), _mm512_set1_ps(S2));
+        ps = _mm512_fmadd_ps(ps, r2, _mm512_set1_ps(S1));
+        __m512 sin_r = _mm512_fmadd_ps(_mm512_mul_ps(ps, r2), r, r);
+        __m512 pc = _mm512_fmadd_ps(r2, _mm512_set1_ps(C3), _mm512_set1_ps(C2));
+        pc = _mm512_fmadd_ps(pc, r2, _mm512_set1_ps(C1));
+        __m512 cos_r = _mm512_fmadd_ps(_mm512_mul_ps(pc, r2), r2,
+            _mm512_fnmadd_ps(_mm512_set1_ps(0.5f), r2, _mm512_set1_ps(1.f)));
+
+        const __m512i one = _mm512_set1_epi32(1), two = _mm512_set1_epi32(2);
+        __mmask16 swap = _mm512_test_epi32_mask(quadrant, one);
+        __m512 sin_sign = _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_and_si512(quadrant, two), 30));
+        __m512 cos_sign = _mm512_castsi512_ps(_mm512_slli_epi32(
+            _mm512_and_si512(_mm512_add_epi32(quadrant, one), two), 30));
+
+        sin_v = xor_avx512(_mm512_mask_blend_ps(swap, sin_r, cos_r), sin_sign);
+        cos_v = xor_avx512(_mm512_mask_blend_ps(swap, cos_r, sin_r), cos_sign);
+    }
+
+    KEPLER_TARGET("avx512f")
+    void avx512_range(const float* a, const float* e, const float* omega, const float* mean_anomaly,
+        size_t begin, size_t end, float mu, float* x, float* y, float* vx, float* vy)
+    {
+        const __m512 one = _mm512_set1_ps(1.f);
+        const __m512 sign_bit = _mm512_set1_ps(-0.f);
+        const __m512 vmu = _mm512_set1_ps(mu);
+
+        const size_t vector_end = begin + (end - begin) / 16 * 16;
+        for (size_t i = begin; i < vector_end; i += 16) {
+            const __m512 ecc = _mm512_loadu_ps(e + i);
+            const __m512 ai = _mm512_loadu_ps(a + i);
+
+            __m512 m = _mm512_loadu_ps(mean_anomaly + i);
+            __m512 k = _mm512_roundscale_ps(_mm512_mul_ps(m, _mm512_set1_ps(INV_TWO_PI)),
+                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            m = _mm512_fnmadd_ps(k, _mm512_set1_ps(TWO_PI_HI), m);
+            m = _mm512_fnmadd_ps(k, _mm512_set1_ps(TWO_PI_LO), m);
+
+            __m512 magnitude = _mm512_mul_ps(_mm512_set1_ps(DANBY), ecc);
+            __m512 start = _mm512_castsi512_ps(_mm512_or_si512(
+                _mm512_and_si512(_mm512_castps_si512(m), _mm512_castps_si512(sign_bit)), _mm512_castps_si512(magnitude)));
+            __m512 E = _mm512_add_ps(m, start);
+
+            __m512 s, c;
+            for (int it = 0; it < ITERATIONS; it++) {
+                sincos_avx512(E, s, c);
+                __m512 f = _mm512_sub_ps(_mm512_fnmadd_ps(ecc, s, E), m);
+                __m512 df = _mm512_fnmadd_ps(ecc, c, one);
+                E = _mm512_sub_ps(E, _mm512_div_ps(f, df));
+            }
+            sincos_avx512(E, s, c);
+
+            __m512 b = _mm512_mul_ps(ai, _mm512_sqrt_ps(_mm512_fnmadd_ps(ecc, ecc, one)));
+            __m512 n = _mm512_sqrt_ps(_mm512_div_ps(vmu, _mm512_mul_ps(ai, _mm512_mul_ps(ai, ai))));
+            __m512 speed = _mm512_div_ps(n, _mm512_fnmadd_ps(ecc, c, one));
+
+            __m512 px = _mm512_mul_ps(ai, _mm512_sub_ps(c, ecc));
+            __m512 py = _mm512_mul_ps(b, s);
+            __m512 pvx = xor_avx512(_mm512_mul_ps(_mm512_mul_ps(ai, speed), s), sign_bit);
+            __m512 pvy = _mm512_mul_ps(_mm512_mul_ps(b, speed), c);
+
+            __m512 so, co;
+            sincos_avx512(_mm512_loadu_ps(omega + i), so, co);
+
+            _mm512_storeu_ps(x + i, _mm512_fmsub_ps(px, co, _mm512_mul_ps(py, so)));
+            _mm512_storeu_ps(y + i, xor_avx512(_mm512_fmadd_ps(px, so, _mm512_mul_ps(py, co)), sign_bit));
+            _mm512_storeu_ps(vx + i, _mm512_fmsub_ps(pvx, co, _mm512_mul_ps(pvy, so)));
+            _mm512_storeu_ps(vy + i, xor_avx512(_mm512_fmadd_ps(pvx, so, _mm512_mul_ps(pvy, co)), sign_bit));
+        }
+
+        scalar_range(a, e, omega, mean_anomaly, vector_end, end, mu, x, y, vx, vy);
+    }
+#endif
+}
+
+namespace KeplerKernels
+{
+    void elements_to_states(const float* a, const float* e, const float* omega, const float* mean_anomaly,
+        size_t n, float mu, float* x, float* y, float* vx, float* vy)
+    {
+        elements_to_states(GravityKernels::detect_isa(), a, e, omega, mean_anomaly, n, mu, x, y, vx, vy);
+    }
+
+    void elements_to_states(GravityKernels::Isa isa, const float* a, const float* e, const float* omega,
+        const float* mean_anomaly, size_t n, float mu, float* x, float* y, float* vx, float* vy)
+    {
+#if KEPLER_X86
+        if (isa == GravityKernels::Isa::AVX512) { avx512_range(a, e, omega, mean_anomaly, 0, n, mu, x, y, vx, vy); return; }
+        if (isa == GravityKernels::Isa::AVX2) { avx2_range(a, e, omega, mean_anomaly, 0, n, mu, x, y, vx, vy); return; }
+#else
+        (void)isa;
+#endif
+        scalar_range(a, e, omega, mean_anomaly, 0, n, mu, x, y, vx, vy);
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include "GravityKernels.h"
+
+// Batch conversion of 2D orbital elements to state vectors.
+// Orbits run counterclockwise on screen (y down), like the built-in planets:
+// a body with omega = 0 and mean anomaly 0 sits at perihelion on the +x side
+// of its primary, moving towards -y. Angles are in radians, omega measured
+// counterclockwise on screen.
+// Kepler's equation E - e sin E = M is solved by Newton's method from
+// Danby's starting value with a fixed number of iterations (enough for float
+// precision up to e = 0.99), so all lanes of a vector take the same path.
+// The SIMD versions use their own polynomial sine and cosine; the
+// instruction set is picked at run time as for the gravity kernels.
+namespace KeplerKernels
+{
+    // Elliptic elements (0 <= e < 1, a > 0) around a primary of
+    // mu = G M at the origin, at rest
+    void elements_to_states(const float* a, const float* e, const float* omega, const float* mean_anomaly,
+        size_t n, float mu, float* x, float* y, float* vx, float* vy);
+
+    // Same with an explicit instruction set (must be supported)
+    void elements_to_states(GravityKernels::Isa isa, const float* a, const float* e, const float* omega,
+        const float* mean_anomaly, size_t n, float mu, float* x, float* y, float* vx, float* vy);
+}
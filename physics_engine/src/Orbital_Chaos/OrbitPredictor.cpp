@@ -0,0 +1,178 @@
+#include "OrbitPredictor.h"
+#include <algorithm>
+#include <cmath>
+
+OrbitPredictor::OrbitPredictor()
+{
+    worker = std::thread(&OrbitPredictor::worker_loop, this);
+}
+
+OrbitPredictor::~OrbitPredictor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+// -------------Main thread----------------
+void OrbitPredictor::update(const std::vector<CelestialBody>& bodies, double time)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (finished) {
+            std::swap(front, back);
+            finished = false;
+            generation++;
+        }
+        if (busy) return;
+    }
+
+    if (!diverged(bodies, time)) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job.bodies = bodies;
+        job.time = time;
+        job.integrator = integrator;
+        job.step = step;
+        job.orbits = orbits;
+        job.max_horizon = max_horizon;
+        job.line_alpha = line_alpha;
+        job.max_points = max_points;
+        busy = true;
+    }
+    wake.notify_one();
+}
+
+// The bodies against the front prediction at time; also true once half of
+// the shortest horizon has passed
+bool OrbitPredictor::diverged(const std::vector<CelestialBody>& bodies, double time) const
+{
+    const Prediction& p = front;
+    if (p.bodies != bodies.size() || p.samples < 2 || p.interval <= 0.0) return true;
+
+    const double position = (time - p.start_time) / p.interval;
+    if (position < 0.0) return true;
+
+    const size_t k = static_cast<size_t>(position);
+    const float t = static_cast<float>(position - static_cast<double>(k));
+
+    for (size_t b = 0; b < p.bodies; b++) {
+        const size_t count = p.counts[b];
+        if (count < 2) continue;
+        if (2 * (k + 1) >= count) return true;
+
+        const sf::Vector2f* path = p.points.data() + b * p.samples;
+        sf::Vector2f predicted = path[k] + (path[k + 1] - path[k]) * t;
+        if ((bodies[b].get_position() - predicted).lengthSquared() > tolerance * tolerance) return true;
+    }
+    return false;
+}
+
+// -------------Worker----------------
+void OrbitPredictor::worker_loop()
+{
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || (busy && !finished); });
+            if (stopping) return;
+        }
+
+        // job and back belong to this thread until busy is cleared
+        predict(job, back);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = !stopping;
+        busy = false;
+    }
+}
+
+void OrbitPredictor::predict(const Job& request, Prediction& out) const
+{
+    const std::vector<CelestialBody>& bodies = request.bodies;
+    const size_t n = bodies.size();
+    const double step_time = std::max(request.step, 1e-6f);
+
+    out.start_time = request.time;
+    out.bodies = n;
+    out.counts.assign(n, 0);
+    if (n == 0) {
+        out.samples = 0;
+        out.points.clear();
+        out.lines.clear();
+        return;
+    }
+
+    // Horizon of each body: its orbits around the heaviest body
+    size_t central = 0;
+    for (size_t i = 1; i < n; i++)
+        if (bodies[i].get_mass() > bodies[central].get_mass()) central = i;
+
+    std::vector<double> horizon(n, request.max_horizon);
+    double longest = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        if (i == central) continue;
+
+        sf::Vector2f r = bodies[i].get_position() - bodies[central].get_position();
+        sf::Vector2f v = bodies[i].get_velocity() - bodies[central].get_velocity();
+        double mu = PhysicsConstants::G * (double(bodies[central].get_mass()) + bodies[i].get_mass());
+        double dist = std::sqrt(double(r.x) * r.x + double(r.y) * r.y);
+        double energy = 0.5 * (double(v.x) * v.x + double(v.y) * v.y) - mu / dist;
+
+        if (dist > 0.0 && mu > 0.0 && energy < 0.0) {
+            double a = -mu / (2.0 * energy);
+            double period = 2.0 * 3.14159265358979 * std::sqrt(a * a * a / mu);
+            horizon[i] = std::min(request.max_horizon, request.orbits * period);
+        }
+        longest = std::max(longest, horizon[i]);
+    }
+    horizon[central] = n > 1 ? longest : request.max_horizon;
+    longest = std::max(longest, horizon[central]);
+
+    const size_t steps = static_cast<size_t>(std::ceil(longest / step_time));
+    const size_t budget = std::max<size_t>(request.max_points, n);
+    const size_t stride = std::max<size_t>(1, (n * (steps + 1) + budget - 1) / budget);
+    out.samples = steps / stride + 1;
+    out.interval = step_time * stride;
+    out.points.resize(n * out.samples);
+    for (size_t i = 0; i < n; i++) {
+        double needed = std::ceil(horizon[i] / out.interval) + 1.0;
+        out.counts[i] = std::min(out.samples, static_cast<size_t>(needed));
+    }
+
+    PhysicsWorld world;
+    world.set_integrator(request.integrator);
+    std::vector<CelestialBody> local = bodies;
+
+    for (size_t k = 0; k < out.samples; k++) {
+        if (k > 0) {
+            for (size_t s = 0; s < stride; s++)
+                world.update_physics(local, static_cast<float>(step_time));
+            if (stopping) return;
+        }
+        for (size_t i = 0; i < n; i++)
+            out.points[i * out.samples + k] = local[i].get_position();
+    }
+
+    // Line segments of the paths within their horizons
+    size_t segments = 0;
+    for (size_t i = 0; i < n; i++)
+        segments += out.counts[i] > 0 ? out.counts[i] - 1 : 0;
+    out.lines.resize(2 * segments);
+
+    sf::Vertex* line = out.lines.data();
+    for (size_t i = 0; i < n; i++) {
+        sf::Color color = bodies[i].get_color();
+        color.a = request.line_alpha;
+
+        const sf::Vector2f* path = out.points.data() + i * out.samples;
+        for (size_t k = 1; k < out.counts[i]; k++) {
+            *line++ = sf::Vertex{ path[k - 1], color };
+            *line++ = sf::Vertex{ path[k], color };
+        }
+    }
+}
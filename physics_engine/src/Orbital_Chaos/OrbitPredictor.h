@@ -0,0 +1,104 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CelestialBody.h"
+#include "PhysicsWorld.h"
+
+// Predicted future paths of the bodies, integrated on a background thread.
+// update() (main thread, every frame) compares the bodies with the published
+// prediction at the current time and, only if one drifted off it by more than
+// the tolerance or the prediction is running out, hands a copy of the bodies
+// to the worker. The worker integrates them ahead in its own world with
+// coarse steps and no thread pool, then publishes through a double buffer:
+// it fills the back prediction while the main thread reads the front one,
+// and update() swaps them once the back one is complete. The worker also
+// builds the line segments to draw, so the main thread only uploads them
+// and never waits for the worker.
+//
+// Every body is predicted for a number of its own orbits (the osculating
+// period around the heaviest body), unbound ones for the longest horizon.
+class OrbitPredictor
+{
+public:
+    struct Prediction {
+        double start_time = 0.0;
+        double interval = 0.0;              // between samples
+        size_t bodies = 0;
+        size_t samples = 0;                 // per body, before trimming
+        std::vector<sf::Vector2f> points;   // sample k of body b at b * samples + k
+        std::vector<size_t> counts;         // samples of body b within its horizon
+        std::vector<sf::Vertex> lines;      // segments of the paths, 2 vertices each
+    };
+
+    OrbitPredictor();
+    ~OrbitPredictor();
+
+    OrbitPredictor(const OrbitPredictor&) = delete;
+    OrbitPredictor& operator=(const OrbitPredictor&) = delete;
+
+    void set_integrator(Integrator i) { integrator = i; }
+    void set_step(float dt) { step = dt; }
+    // Orbits of each body to predict, and a bound on the prediction time
+    void set_orbits(float count) { orbits = count; }
+    void set_max_horizon(double time) { max_horizon = time; }
+    // Largest distance between a body and its prediction before recomputing
+    void set_tolerance(float distance) { tolerance = distance; }
+    // Opacity of the lines (colored like their bodies)
+    void set_line_alpha(std::uint8_t alpha) { line_alpha = alpha; }
+    // Bound on the samples of a prediction (bodies x samples); beyond it the
+    // samples are thinned out to every few steps. Each sample costs about
+    // 48 B in each of the two predictions (its point and 2 line vertices)
+    // and 40 B of vertex buffer, so the default 1 << 18 stays under 36 MB
+    void set_max_points(size_t count) { max_points = count; }
+
+    // Main thread, once per frame with the simulation time
+    void update(const std::vector<CelestialBody>& bodies, double time);
+
+    // Latest complete prediction; valid until the next update()
+    const Prediction& get_prediction() const { return front; }
+    // Changes whenever update() publishes a new prediction
+    unsigned long long get_generation() const { return generation; }
+
+private:
+    Integrator integrator = Integrator::WisdomHolman;
+    float step = 0.5f;
+    float orbits = 1.f;
+    double max_horizon = 5000.0;
+    float tolerance = 2.f;
+    std::uint8_t line_alpha = 50;
+    size_t max_points = size_t(1) << 18;
+
+    Prediction front;       // main thread
+    Prediction back;        // worker while busy, then main thread
+    unsigned long long generation = 0;
+
+    // What the worker integrates, with the settings at hand-off time
+    struct Job {
+        std::vector<CelestialBody> bodies;
+        double time = 0.0;
+        Integrator integrator = Integrator::WisdomHolman;
+        float step = 0.5f;
+        float orbits = 1.f;
+        double max_horizon = 0.0;
+        std::uint8_t line_alpha = 50;
+        size_t max_points = 0;
+    };
+
+    // Handoff (under mutex)
+    std::mutex mutex;
+    std::condition_variable wake;
+    Job job;
+    bool busy = false;      // worker owns back and job
+    bool finished = false;  // back holds a new prediction
+    std::atomic<bool> stopping{ false };
+    std::thread worker;
+
+    bool diverged(const std::vector<CelestialBody>& bodies, double time) const;
+    void worker_loop();
+    void predict(const Job& request, Prediction& out) const;
+};
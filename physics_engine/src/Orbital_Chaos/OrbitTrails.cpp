@@ -0,0 +1,282 @@
+#include "OrbitTrails.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Above this many separate ranges, one upload of their span is cheaper
+    const size_t MAX_UPLOADS = 16;
+
+    const sf::Vertex BLANK{ { 0.f, 0.f }, sf::Color::Transparent };
+
+    // The sample time travels in the x texture coordinate
+    const char* FADE_VERTEX =
+        "uniform float now;\n"
+        "uniform float fade_time;\n"
+        "void main()\n"
+        "{\n"
+        "    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;\n"
+        "    float age = (now - gl_MultiTexCoord0.x) / fade_time;\n"
+        "    gl_FrontColor = vec4(gl_Color.rgb, gl_Color.a * clamp(1.0 - age, 0.0, 1.0));\n"
+        "}\n";
+
+    const char* FADE_FRAGMENT =
+        "void main()\n"
+        "{\n"
+        "    gl_FragColor = gl_Color;\n"
+        "}\n";
+}
+
+OrbitTrails::OrbitTrails(size_t capacity)
+    : capacity(std::max<size_t>(capacity, 1))
+{
+}
+
+size_t OrbitTrails::add_trail(sf::Color color)
+{
+    return add_trails({ color });
+}
+
+void OrbitTrails::erase_trail(size_t index)
+{
+    erase_trails({ index });
+}
+
+size_t OrbitTrails::add_trails(const std::vector<sf::Color>& colors)
+{
+    const size_t old_count = rings.size();
+    if (colors.empty()) return old_count;
+
+    std::vector<size_t> kept(old_count);
+    for (size_t i = 0; i < old_count; i++) kept[i] = i;
+
+    rings.resize(old_count + colors.size());
+    for (size_t i = 0; i < colors.size(); i++)
+        rings[old_count + i].color = colors[i];
+    relayout(old_count, kept);
+    return old_count;
+}
+
+void OrbitTrails::erase_trails(const std::vector<size_t>& indices)
+{
+    const size_t old_count = rings.size();
+
+    std::vector<size_t> kept;
+    kept.reserve(old_count);
+    size_t next = 0;
+    for (size_t i = 0; i < old_count; i++) {
+        while (next < indices.size() && indices[next] < i) next++;
+        if (next < indices.size() && indices[next] == i) continue;
+        kept.push_back(i);
+    }
+    if (kept.size() == old_count) return;
+
+    size_t to = 0;
+    for (size_t from : kept)
+        rings[to++] = rings[from];
+    rings.resize(to);
+    relayout(old_count, kept);
+}
+
+// Rebuild the slot-major layout for the current rings from one with
+// old_count bodies; ring i was ring kept[i] before, and the rings past the
+// kept ones are new
+void OrbitTrails::relayout(size_t old_count, const std::vector<size_t>& kept)
+{
+    const size_t count = rings.size();
+    std::vector<sf::Vertex> moved(2 * capacity * count, BLANK);
+
+    for (size_t slot = 0; slot < capacity; slot++) {
+        for (size_t to = 0; to < kept.size(); to++) {
+            const size_t source = 2 * (slot * old_count + kept[to]);
+            const size_t target = 2 * segment(to, slot);
+            moved[target] = vertices[source];
+            moved[target + 1] = vertices[source + 1];
+        }
+    }
+
+    vertices.swap(moved);
+    dirty.clear();
+    rebuild = true;
+}
+
+void OrbitTrails::append(size_t index, sf::Vector2f point, float time)
+{
+    Ring& ring = rings[index];
+
+    if (ring.started) {
+        const size_t s = segment(index, ring.head);
+        vertices[2 * s] = sf::Vertex{ ring.last, ring.color, { ring.last_time, 0.f } };
+        vertices[2 * s + 1] = sf::Vertex{ point, ring.color, { time, 0.f } };
+        dirty.push_back(s);
+        ring.head = (ring.head + 1) % capacity;
+
+        ring.min_x = std::min({ ring.min_x, ring.last.x, point.x });
+        ring.min_y = std::min({ ring.min_y, ring.last.y, point.y });
+        ring.max_x = std::max({ ring.max_x, ring.last.x, point.x });
+        ring.max_y = std::max({ ring.max_y, ring.last.y, point.y });
+
+        // Every slot is written now: shrink to the segments still there
+        if (ring.head == 0) {
+            ring.min_x = ring.min_y = INFINITY;
+            ring.max_x = ring.max_y = -INFINITY;
+            for (size_t slot = 0; slot < capacity; slot++) {
+                for (size_t v = 2 * segment(index, slot); v < 2 * segment(index, slot) + 2; v++) {
+                    ring.min_x = std::min(ring.min_x, vertices[v].position.x);
+                    ring.min_y = std::min(ring.min_y, vertices[v].position.y);
+                    ring.max_x = std::max(ring.max_x, vertices[v].position.x);
+                    ring.max_y = std::max(ring.max_y, vertices[v].position.y);
+                }
+            }
+        }
+    }
+
+    ring.started = true;
+    ring.last = point;
+    ring.last_time = time;
+    ring.pending = false;
+    ring.has_axis = false;
+}
+
+void OrbitTrails::offer(size_t index, sf::Vector2f point, float time)
+{
+    Ring& ring = rings[index];
+    if (!ring.started) {
+        append(index, point, time);
+        return;
+    }
+
+    const sf::Vector2f d = point - ring.last;
+    const float distance = d.length();
+
+    // Too long for one segment: close the current one first
+    if (distance > max_segment) {
+        if (!ring.pending) {
+            append(index, point, time);
+            return;
+        }
+        append(index, ring.tip, ring.tip_time);
+        offer(index, point, time);
+        return;
+    }
+
+    if (distance > tolerance) {
+        if (!ring.has_axis) {
+            ring.has_axis = true;
+            ring.axis = d / distance;
+            ring.low = -3.14159265f;
+            ring.high = 3.14159265f;
+            ring.reach = 0.f;
+        }
+
+        // Leaving the sleeve, or turning back (points past the end of the
+        // segment would not be covered): the segment ends at the previous point
+        const float angle = std::atan2(ring.axis.cross(d), ring.axis.dot(d));
+        if (angle < ring.low || angle > ring.high || distance < ring.reach - tolerance) {
+            append(index, ring.tip, ring.tip_time);
+            offer(index, point, time);
+            return;
+        }
+
+        const float half = std::asin(tolerance / distance);
+        ring.low = std::max(ring.low, angle - half);
+        ring.high = std::min(ring.high, angle + half);
+        ring.reach = std::max(ring.reach, distance);
+    }
+
+    ring.pending = true;
+    ring.tip = point;
+    ring.tip_time = time;
+}
+
+void OrbitTrails::upload()
+{
+    if (rebuild) {
+        dirty.clear();
+        if (buffer.getVertexCount() != vertices.size() && !buffer.create(vertices.size())) return;
+        rebuild = !buffer.update(vertices.data());
+        return;
+    }
+    if (dirty.empty()) return;
+
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+    // Contiguous runs of segments
+    std::vector<std::pair<size_t, size_t>> runs;
+    for (size_t s : dirty) {
+        if (!runs.empty() && runs.back().second == s)
+            runs.back().second++;
+        else
+            runs.push_back({ s, s + 1 });
+    }
+    if (runs.size() > MAX_UPLOADS)
+        runs = { { runs.front().first, runs.back().second } };
+
+    for (const auto& run : runs) {
+        (void)buffer.update(vertices.data() + 2 * run.first, 2 * (run.second - run.first),
+            static_cast<unsigned int>(2 * run.first));
+    }
+    dirty.clear();
+}
+
+sf::FloatRect OrbitTrails::get_bounds(size_t index) const
+{
+    const Ring& ring = rings[index];
+    if (ring.min_x > ring.max_x) return {};
+    return { { ring.min_x, ring.min_y }, { ring.max_x - ring.min_x, ring.max_y - ring.min_y } };
+}
+
+sf::RenderStates OrbitTrails::fade_states(float now, float fade_time)
+{
+    if (!shader_tried) {
+        shader_tried = true;
+        shader_ready = sf::Shader::isAvailable() && fade.loadFromMemory(FADE_VERTEX, FADE_FRAGMENT);
+    }
+
+    sf::RenderStates states;
+    if (shader_ready) {
+        fade.setUniform("now", now);
+        fade.setUniform("fade_time", std::max(fade_time, 1e-6f));
+        states.shader = &fade;
+    }
+    return states;
+}
+
+void OrbitTrails::draw(sf::RenderTarget& target, float now, float fade_time, const std::vector<uint32_t>& visible)
+{
+    if (2 * visible.size() >= rings.size()) {
+        draw(target, now, fade_time);
+        return;
+    }
+
+    // Keep the buffer current for when the view zooms back out
+    if (sf::VertexBuffer::isAvailable()) upload();
+    else dirty.clear();
+
+    culled.clear();
+    for (uint32_t index : visible) {
+        for (size_t slot = 0; slot < capacity; slot++) {
+            const size_t s = segment(index, slot);
+            culled.push_back(vertices[2 * s]);
+            culled.push_back(vertices[2 * s + 1]);
+        }
+    }
+    if (!culled.empty())
+        target.draw(culled.data(), culled.size(), sf::PrimitiveType::Lines, fade_states(now, fade_time));
+}
+
+void OrbitTrails::draw(sf::RenderTarget& target, float now, float fade_time)
+{
+    if (vertices.empty()) return;
+
+    const sf::RenderStates states = fade_states(now, fade_time);
+
+    if (!sf::VertexBuffer::isAvailable()) {
+        target.draw(vertices.data(), vertices.size(), sf::PrimitiveType::Lines, states);
+        dirty.clear();
+        return;
+    }
+
+    upload();
+    target.draw(buffer, states);
+}
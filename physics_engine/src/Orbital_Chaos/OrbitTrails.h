@@ -0,0 +1,111 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Orbital trails of all bodies, drawn as one batch of line segments.
+// Each body owns a fixed-capacity ring of segments (one per appended point);
+// the rings live in a single streaming vertex buffer, laid out slot-major
+// (slot k of body b at segment k * bodies + b), so bodies sampled together
+// write neighbouring segments and a frame uploads only what was appended,
+// coalesced into a few contiguous ranges.
+//
+// Vertices keep their sample time; a small shader fades them with age, so
+// appending never rewrites older vertices. Without shaders the trails are
+// drawn unfaded, and without vertex buffers from the CPU copy.
+//
+// Positions offered every frame are simplified online (Zhao & Saalfeld's
+// sleeve): a segment grows while some line from its start still passes
+// within the tolerance of every point it covers, so straight stretches take
+// one long segment and tight turns many short ones, and the capacity (the
+// per-body memory budget) covers far more of the orbit than fixed-rate
+// sampling.
+class OrbitTrails
+{
+public:
+    explicit OrbitTrails(size_t capacity = 500);
+
+    // Segments kept per body
+    size_t get_capacity() const { return capacity; }
+
+    // Largest distance of an offered point from its segment, and the longest
+    // segment (which bounds how far a trail lags behind its body)
+    void set_tolerance(float distance) { tolerance = distance; }
+    void set_max_segment(float length) { max_segment = length; }
+
+    // New, empty trail at the end, color (and alpha) of its newest segment;
+    // returns its index
+    size_t add_trail(sf::Color color);
+    // Trails after it move down by one (like the bodies)
+    void erase_trail(size_t index);
+
+    // Batches of the above with one relayout (each is O(capacity * trails)):
+    // one trail per color, returning the index of the first, and the trails
+    // at ascending indices (as PhysicsWorld::get_removed_bodies)
+    size_t add_trails(const std::vector<sf::Color>& colors);
+    void erase_trails(const std::vector<size_t>& indices);
+    size_t size() const { return rings.size(); }
+
+    // Extend a trail to point, stamped with time (the first point of a
+    // trail only starts it)
+    void append(size_t index, sf::Vector2f point, float time);
+    // Simplified: only appends once the point can no longer be covered
+    void offer(size_t index, sf::Vector2f point, float time);
+
+    // Box around all segments of a trail (empty before its first segment)
+    sf::FloatRect get_bounds(size_t index) const;
+
+    // Segments fade out linearly over fade_time
+    void draw(sf::RenderTarget& target, float now, float fade_time);
+    // Only the listed trails (culled by the caller); when most are listed,
+    // drawing the whole buffer is cheaper and is done instead
+    void draw(sf::RenderTarget& target, float now, float fade_time, const std::vector<uint32_t>& visible);
+
+private:
+    struct Ring {
+        size_t head = 0;        // next slot to write
+        bool started = false;
+        sf::Vector2f last;
+        float last_time = 0.f;
+        sf::Color color;
+
+        // Sleeve of the growing segment: latest point offered, and the
+        // directions from last (angles from axis) within tolerance of every
+        // point since
+        bool pending = false;
+        sf::Vector2f tip;
+        float tip_time = 0.f;
+        bool has_axis = false;
+        sf::Vector2f axis;
+        float low = 0.f, high = 0.f;
+        float reach = 0.f;      // farthest point from last so far
+
+        // Bounds of the segments, grown by every append and recomputed
+        // whenever the ring wraps around
+        float min_x = INFINITY, min_y = INFINITY;
+        float max_x = -INFINITY, max_y = -INFINITY;
+    };
+
+    size_t capacity;
+    float tolerance = 0.25f;
+    float max_segment = 16.f;
+    std::vector<Ring> rings;
+
+    // CPU copy of the buffer, 2 vertices per segment
+    std::vector<sf::Vertex> vertices;
+    std::vector<sf::Vertex> culled; // listed trails, when drawn from the CPU copy
+    std::vector<size_t> dirty;      // segments written since the last upload
+    bool rebuild = true;            // layout changed: upload everything
+
+    sf::VertexBuffer buffer{ sf::PrimitiveType::Lines, sf::VertexBuffer::Usage::Stream };
+    sf::Shader fade;
+    bool shader_tried = false;
+    bool shader_ready = false;
+
+    size_t segment(size_t index, size_t slot) const { return slot * rings.size() + index; }
+    void relayout(size_t old_count, const std::vector<size_t>& kept);
+    void upload();
+    sf::RenderStates fade_states(float now, float fade_time);
+};
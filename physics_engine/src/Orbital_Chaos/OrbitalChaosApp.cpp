@@ -1,9 +1,12 @@
 ﻿#include "OrbitalChaosApp.h"
 #include "PhysicsWorld.h"
+#include "BodyCatalog.h"
 
 #include <random>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <filesystem>
 
 // Diagnostics for Confirming the planetary motion...
 /* static void printDiagnostics(const std::vector<CelestialBody>& bodies)
@@ -48,11 +51,48 @@
     std::cout << "------------------------------------\n";
 }
 */
+// Newest trail segments at this opacity, fading out with age
+static sf::Color trail_color(sf::Color color)
+{
+    color.a = 80;
+    return color;
+}
+
 OrbitalChaosApp::OrbitalChaosApp()
     : maxSize(1200.f, 900.f),
-    minSize(0.f, 0.f)
+    minSize(0.f, 0.f),
+    orbital_trails(TRAIL_SEGMENTS)
 {
+    workers = std::make_unique<ThreadPool>();
+
     setup_bodies();
+    setup_belt();
+
+    physics_world.set_integrator(Integrator::WisdomHolman);
+    physics_world.set_collisions(true);
+
+    // The sun dominates, so Wisdom-Holman steps (exact Kepler drifts + planet
+    // kicks) can be long (see benchmarks/); the controller only cuts a frame
+    // finer when a close approach makes the error grow. Float state alone
+    // changes the energy by up to ~1e-7 a frame, so the tolerance sits 100x
+    // above that round-off: quiet frames then measure as within it and fall
+    // back to one substep, and only real truncation error pushes the count
+    // up towards 200, instead of the noise holding it at the maximum
+    substep_controller.set_order(integrator_order(Integrator::WisdomHolman));
+    substep_controller.set_tolerance(1e-5);
+    substep_controller.set_substep_range(1, 200);
+
+    physics_world.set_thread_pool(workers.get());
+
+    potential_field.set_thread_pool(workers.get());
+    body_cull.tree.set_thread_pool(workers.get());
+    belt_cull.tree.set_thread_pool(workers.get());
+    trail_cull.tree.set_thread_pool(workers.get());
+
+    camera = sf::View(sf::FloatRect(minSize, maxSize - minSize));
+    belt_vertices.setPrimitiveType(sf::PrimitiveType::Points);
+    body_points.setPrimitiveType(sf::PrimitiveType::Points);
+    splats.setPrimitiveType(sf::PrimitiveType::Triangles);
 }
 
 OrbitalChaosApp::~OrbitalChaosApp() {}
@@ -66,7 +106,9 @@ void OrbitalChaosApp::setup_bodies()
     sun.set_radius(20.f);
 
     bodies.push_back(sun);
-    orbital_trails.push_back({});
+    orbital_trails.add_trail(trail_color(sun.get_color()));
+
+    if (load_catalog()) return;
 
     // ---- Planet data ----
     struct PlanetData {
@@ -91,6 +133,7 @@ void OrbitalChaosApp::setup_bodies()
 
     sf::Vector2f sun_pos = bodies[0].get_position();
     float sun_mass = bodies[0].get_mass();
+    std::vector<sf::Color> colors;
 
     for (const auto& data : planet_data)
     {
@@ -111,8 +154,82 @@ void OrbitalChaosApp::setup_bodies()
         p.set_radius(data.planet_size);
 
         bodies.push_back(p);
-        orbital_trails.push_back({});
+        colors.push_back(trail_color(data.color));
     }
+    orbital_trails.add_trails(colors);
+}
+
+// Bodies around the sun from the first catalog file found: massive rows
+// join the planets, massless ones the belt
+bool OrbitalChaosApp::load_catalog()
+{
+    for (const char* path : CATALOG_FILES)
+    {
+        if (!std::filesystem::exists(path)) continue;
+
+        BodyCatalog catalog;
+        try
+        {
+            catalog.load(path, &bodies[0], workers.get());
+        }
+        catch (const std::runtime_error& error)
+        {
+            std::cerr << "Catalog not loaded: " << error.what() << "\n";
+            return false;
+        }
+
+        size_t first = bodies.size();
+        catalog.append_bodies(bodies);
+        std::vector<sf::Color> colors;
+        colors.reserve(bodies.size() - first);
+        for (size_t i = first; i < bodies.size(); ++i)
+            colors.push_back(trail_color(bodies[i].get_color()));
+        orbital_trails.add_trails(colors);
+
+        catalog.append_particles(physics_world.get_test_particles());
+        for (size_t i = 0; i < catalog.size(); ++i)
+            if (catalog.get_mass(i) <= 0.f)
+                belt_colors.push_back(catalog.get_color(i));
+
+        std::cout << "Loaded " << catalog.size() << " bodies from " << path << "\n";
+        return true;
+    }
+    return false;
+}
+
+void OrbitalChaosApp::setup_belt()
+{
+    // A catalog brought its own
+    if (physics_world.get_test_particles().size() > 0) return;
+
+    // Between the Mars and Jupiter perihelia, on slightly eccentric orbits
+    // around the sun; the planets stir it up over time
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> radius(185.f, 225.f);
+    std::uniform_real_distribution<float> angle(0.f, 6.2831853f);
+    std::uniform_real_distribution<float> kick(-0.03f, 0.03f);
+
+    sf::Vector2f sun_pos = bodies[0].get_position();
+    float mu = PhysicsConstants::G * bodies[0].get_mass();
+
+    auto& belt = physics_world.get_test_particles();
+    belt.reserve(BELT_PARTICLES);
+
+    for (size_t i = 0; i < BELT_PARTICLES; ++i)
+    {
+        float r = radius(rng);
+        float phi = angle(rng);
+        sf::Vector2f dir(std::cos(phi), std::sin(phi));
+
+        // Circular speed, counterclockwise like the planets, plus a small random part
+        float v = std::sqrt(mu / r);
+        sf::Vector2f vel(dir.y * v, -dir.x * v);
+        vel += sf::Vector2f(kick(rng), kick(rng)) * v;
+
+        belt.add(sun_pos + dir * r, vel);
+    }
+
+    belt_colors.assign(BELT_PARTICLES, sf::Color(150, 140, 120, 160));
 }
 
 void OrbitalChaosApp::initialize()
@@ -128,54 +245,218 @@ void OrbitalChaosApp::initialize()
 
 void OrbitalChaosApp::update_trails()
 {
-    trail_update_counter++;
+    // Every frame; the trails keep only the points their shape needs
+    for (size_t i = 0; i < bodies.size(); ++i)
+        orbital_trails.offer(i, bodies[i].get_position(), static_cast<float>(frame_count));
+}
 
-    if (trail_update_counter >= TRAIL_UPDATE_INTERVAL)
+void OrbitalChaosApp::render_trails()
+{
+    // Culled by the boxes around the trails
+    const size_t n = orbital_trails.size();
+    trail_cull.resize(n);
+    for (size_t i = 0; i < n; ++i)
     {
-        trail_update_counter = 0;
+        sf::FloatRect bounds = orbital_trails.get_bounds(i);
+        trail_cull.x[i] = bounds.position.x + 0.5f * bounds.size.x;
+        trail_cull.y[i] = bounds.position.y + 0.5f * bounds.size.y;
+        trail_cull.half_w[i] = 0.5f * bounds.size.x;
+        trail_cull.half_h[i] = 0.5f * bounds.size.y;
+    }
+    trail_cull.tree.update(trail_cull.x.data(), trail_cull.y.data(), trail_cull.half_w.data(), trail_cull.half_h.data(), n);
+    trail_cull.tree.query(visible_area(), 0.f, visible, clusters);
 
-        for (size_t i = 0; i < bodies.size(); ++i)
-        {
-            orbital_trails[i].push_back(bodies[i].get_position());
+    orbital_trails.draw(window, static_cast<float>(frame_count), TRAIL_FADE_FRAMES, visible);
+}
 
-            if (orbital_trails[i].size() > MAX_TRAIL_LENGTH)
-                orbital_trails[i].pop_front();
-        }
+void OrbitalChaosApp::render_predictions()
+{
+    // The worker built the lines: they are uploaded once per published
+    // prediction, or drawn from its copy without vertex buffers
+    const auto& prediction = orbit_predictor.get_prediction();
+    if (prediction.lines.empty()) return;
+
+    if (orbit_predictor.get_generation() != prediction_generation && sf::VertexBuffer::isAvailable())
+    {
+        const bool sized = prediction_lines.getVertexCount() == prediction.lines.size()
+            || prediction_lines.create(prediction.lines.size());
+        if (sized && prediction_lines.update(prediction.lines.data()))
+            prediction_generation = orbit_predictor.get_generation();
     }
+
+    if (orbit_predictor.get_generation() == prediction_generation)
+        window.draw(prediction_lines);
+    else
+        window.draw(prediction.lines.data(), prediction.lines.size(), sf::PrimitiveType::Lines);
 }
 
-void OrbitalChaosApp::render_trails()
+void OrbitalChaosApp::render_belt()
 {
-    for (size_t i = 0; i < orbital_trails.size(); ++i)
+    const auto& belt = physics_world.get_test_particles();
+    const size_t n = belt.size();
+
+    belt_cull.resize(n);
+    for (size_t i = 0; i < n; ++i)
     {
-        const auto& trail = orbital_trails[i];
+        sf::Vector2f p = belt.get_position(i);
+        belt_cull.x[i] = p.x;
+        belt_cull.y[i] = p.y;
+    }
+    belt_cull.tree.update(belt_cull.x.data(), belt_cull.y.data(), nullptr, nullptr, n);
 
-        if (trail.size() < 2) continue;
+    // Points where the belt is sparse, splats where it is dense
+    const float pixel = pixel_size();
+    belt_cull.tree.query(visible_area(), SPLAT_PIXELS * pixel, visible, clusters);
 
-        sf::Color base = bodies[i].get_color();
+    belt_vertices.clear();
+    for (uint32_t i : visible)
+        belt_vertices.append(sf::Vertex{ { belt_cull.x[i], belt_cull.y[i] }, belt_colors[i] });
+    window.draw(belt_vertices);
 
-        for (size_t j = 0; j < trail.size(); ++j)
-        {
-            float t = (float)j / trail.size();
+    splats.clear();
+    for (uint32_t c : clusters)
+    {
+        const auto& node = belt_cull.tree.get_nodes()[c];
+        append_splat(node, belt_colors[belt_cull.tree.get_order()[node.begin]], pixel);
+    }
+    window.draw(splats);
+}
 
-            sf::Color c = base;
-            c.a = (uint8_t)(80 * t);
+void OrbitalChaosApp::render_bodies()
+{
+    const size_t n = bodies.size();
+    body_cull.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        body_cull.x[i] = bodies[i].get_position().x;
+        body_cull.y[i] = bodies[i].get_position().y;
+        body_cull.half_w[i] = bodies[i].get_radius();
+    }
+    body_cull.tree.update(body_cull.x.data(), body_cull.y.data(), body_cull.half_w.data(), body_cull.half_w.data(), n);
 
-            sf::CircleShape dot(1.5f);
-            dot.setOrigin({ 1.5f, 1.5f });
-            dot.setFillColor(c);
-            dot.setPosition(trail[j]);
+    const float pixel = pixel_size();
+    body_cull.tree.query(visible_area(), SPLAT_PIXELS * pixel, visible, clusters);
+
+    // Discs down to a pixel, points below
+    body_points.clear();
+    for (uint32_t i : visible)
+    {
+        if (bodies[i].get_radius() >= pixel)
+            bodies[i].render(window);
+        else
+            body_points.append(sf::Vertex{ bodies[i].get_position(), bodies[i].get_color() });
+    }
+    window.draw(body_points);
 
-            window.draw(dot);
+    splats.clear();
+    for (uint32_t c : clusters)
+    {
+        const auto& node = body_cull.tree.get_nodes()[c];
+        append_splat(node, bodies[body_cull.tree.get_order()[node.begin]].get_color(), pixel);
+    }
+    window.draw(splats);
+}
+
+// One quad for all items of a node, as opaque as that many overlapping items
+void OrbitalChaosApp::append_splat(const ViewQuadtree::Node& node, sf::Color color, float pixel)
+{
+    const float count = static_cast<float>(node.end - node.begin);
+    color.a = static_cast<std::uint8_t>(255.f * (1.f - std::pow(1.f - color.a / 255.f, count)));
+
+    const float cx = 0.5f * (node.min_x + node.max_x), cy = 0.5f * (node.min_y + node.max_y);
+    const float hw = 0.5f * std::max(node.max_x - node.min_x, pixel);
+    const float hh = 0.5f * std::max(node.max_y - node.min_y, pixel);
+    const sf::Vector2f corners[6] = {
+        { cx - hw, cy - hh }, { cx + hw, cy - hh }, { cx + hw, cy + hh },
+        { cx - hw, cy - hh }, { cx + hw, cy + hh }, { cx - hw, cy + hh }
+    };
+    for (const sf::Vector2f& corner : corners)
+        splats.append(sf::Vertex{ corner, color });
+}
+
+// -------------Camera----------------
+sf::FloatRect OrbitalChaosApp::visible_area() const
+{
+    return { camera.getCenter() - 0.5f * camera.getSize(), camera.getSize() };
+}
+
+// World size of a screen pixel
+float OrbitalChaosApp::pixel_size() const
+{
+    return camera.getSize().x / maxSize.x;
+}
+
+// Zoom by steps of the wheel, keeping the point under the cursor in place
+void OrbitalChaosApp::zoom_camera(float steps, sf::Vector2i pixel)
+{
+    const sf::Vector2f before = window.mapPixelToCoords(pixel, camera);
+
+    float factor = std::pow(ZOOM_STEP, -steps);
+    const float width = std::clamp(camera.getSize().x * factor, MIN_VIEW_WIDTH, MAX_VIEW_WIDTH);
+    factor = width / camera.getSize().x;
+    camera.zoom(factor);
+
+    camera.move(before - window.mapPixelToCoords(pixel, camera));
+}
+
+void OrbitalChaosApp::handle_camera_event(const sf::Event& event)
+{
+    if (const auto* wheel = event.getIf<sf::Event::MouseWheelScrolled>())
+    {
+        zoom_camera(wheel->delta, wheel->position);
+    }
+    else if (const auto* press = event.getIf<sf::Event::MouseButtonPressed>())
+    {
+        if (press->button == sf::Mouse::Button::Left)
+        {
+            panning = true;
+            pan_anchor = press->position;
+        }
+    }
+    else if (const auto* release = event.getIf<sf::Event::MouseButtonReleased>())
+    {
+        if (release->button == sf::Mouse::Button::Left)
+            panning = false;
+    }
+    else if (const auto* move = event.getIf<sf::Event::MouseMoved>())
+    {
+        if (panning)
+        {
+            camera.move(window.mapPixelToCoords(pan_anchor, camera) - window.mapPixelToCoords(move->position, camera));
+            pan_anchor = move->position;
         }
     }
+    else if (const auto* key = event.getIf<sf::Event::KeyPressed>())
+    {
+        if (key->code == sf::Keyboard::Key::Home)
+            camera = sf::View(sf::FloatRect(minSize, maxSize - minSize));
+    }
+}
+
+void OrbitalChaosApp::cycle_field_overlay()
+{
+    if (!show_field)
+    {
+        show_field = true;
+        potential_field.set_quantity(FieldQuantity::Potential);
+    }
+    else if (potential_field.get_quantity() == FieldQuantity::Potential)
+    {
+        potential_field.set_quantity(FieldQuantity::Acceleration);
+    }
+    else
+    {
+        show_field = false;
+    }
+
+    // Moves while hidden were not tracked
+    potential_field.invalidate();
 }
 
 void OrbitalChaosApp::run()
 {
     sf::Clock clock;
 
-    const int   PHYSICS_SUBSTEPS = 40;
     const float TIME_SCALE = 10.2f;  // Speed up simulation
 
     while (window.isOpen())
@@ -185,18 +466,41 @@ void OrbitalChaosApp::run()
         {
             if (eventOpt->is<sf::Event::Closed>())
                 window.close();
+
+            // F: field overlay off -> potential -> acceleration -> off
+            if (const auto* key = eventOpt->getIf<sf::Event::KeyPressed>())
+                if (key->code == sf::Keyboard::Key::F)
+                    cycle_field_overlay();
+
+            handle_camera_event(*eventOpt);
         }
 
         float frame_dt = clock.restart().asSeconds();
         if (frame_dt > 0.25f) frame_dt = 0.25f;
 
-        float physics_dt = (frame_dt * TIME_SCALE) / (float)PHYSICS_SUBSTEPS;
+        const float frame_time = frame_dt * TIME_SCALE;
+        const unsigned int substeps = substep_controller.substeps(frame_time);
+        float physics_dt = frame_time / (float)substeps;
+        bool merged = false;
 
-        for (int n = 0; n < PHYSICS_SUBSTEPS; ++n)
+        for (unsigned int n = 0; n < substeps; ++n)
         {
             physics_world.update_physics(bodies, physics_dt);
+
+            // Merged bodies take their trails with them
+            const auto& removed = physics_world.get_removed_bodies();
+            orbital_trails.erase_trails(removed);
+            merged = merged || !removed.empty();
         }
 
+        // Merges dissipate energy, so that frame says nothing about the step
+        if (merged) substep_controller.reset();
+        substep_controller.update(physics_world.total_energy(bodies), physics_world.total_angular_momentum(bodies),
+            frame_time, substeps);
+
+        simulation_time += frame_time;
+        orbit_predictor.update(bodies, simulation_time);
+
         // For Diagnostics...
         /*static int frameCounter = 0;
         frameCounter++;
@@ -207,14 +511,27 @@ void OrbitalChaosApp::run()
         }
         */
 
+        frame_count++;
         update_trails();
 
+        if (show_field)
+        {
+            // Over the visible area (a new view re-evaluates every tile)
+            potential_field.set_region(visible_area(),
+                { static_cast<unsigned>(maxSize.x / FIELD_SPACING), static_cast<unsigned>(maxSize.y / FIELD_SPACING) });
+            potential_field.set_gravity_solver(physics_world.get_gravity_solver());
+            potential_field.update(bodies);
+        }
+
         window.clear(sf::Color::Black);
+        window.setView(camera);
 
+        if (show_field)
+            potential_field.draw(window);
+        render_predictions();
         render_trails();
-
-        for (auto& b : bodies)
-            b.render(window);
+        render_belt();
+        render_bodies();
 
         window.display();
     }
@@ -225,5 +542,8 @@ void OrbitalChaosApp::cleanup()
     if (window.isOpen())
         window.close();
 
+    physics_world.set_thread_pool(nullptr);
+    workers.reset();
+
     std::cout << "Simulation exited cleanly.\n";
 }
\ No newline at end of file
@@ -1,9 +1,15 @@
 #pragma once
 #include <SFML/Graphics.hpp>
 #include <vector>
-#include <deque>
+#include <memory>
 #include "CelestialBody.h"
+#include "OrbitTrails.h"
+#include "OrbitPredictor.h"
 #include "PhysicsWorld.h"
+#include "PotentialField.h"
+#include "SubstepController.h"
+#include "ViewQuadtree.h"
+#include "../Common/ThreadPool.h"
 
 class OrbitalChaosApp {
 private:
@@ -14,14 +20,61 @@ private:
     // Sun + planets stored together
     std::vector<CelestialBody> bodies;
 
-    // Orbital trails (only for planets, not sun)
-    std::vector<std::deque<sf::Vector2f>> orbital_trails;
+    // Orbital trails, one per body, sampled by curvature: the segment budget
+    // per body covers the fade time with room to spare
+    const size_t TRAIL_SEGMENTS = 160;
+    const float TRAIL_FADE_FRAMES = 1500.f;
+    OrbitTrails orbital_trails;
+    unsigned int frame_count = 0;   // trail clock
 
-    const size_t MAX_TRAIL_LENGTH = 500;
-    int trail_update_counter = 0;
-    const int TRAIL_UPDATE_INTERVAL = 3;
+    // Optional catalogs of bodies around the sun (binary or CSV, see
+    // BodyCatalog), in place of the built-in planets and belt
+    static constexpr const char* CATALOG_FILES[] = { "assets/orbital_catalog.ocat", "assets/orbital_catalog.csv" };
+
+    // Asteroid belt (massless test particles of the physics world)
+    const size_t BELT_PARTICLES = 20000;
+    std::vector<sf::Color> belt_colors;
+    sf::VertexArray belt_vertices;  // visible part
+
+    // Predicted paths, one orbit ahead (computed in the background)
+    OrbitPredictor orbit_predictor;
+    sf::VertexBuffer prediction_lines{ sf::PrimitiveType::Lines, sf::VertexBuffer::Usage::Static };
+    unsigned long long prediction_generation = 0;
+    double simulation_time = 0.0;
+
+    // Field heatmap (F), sampled every few pixels
+    const float FIELD_SPACING = 4.f;
+    PotentialField potential_field;
+    bool show_field = false;
+
+    // Camera: the wheel zooms about the cursor, left drag pans, Home resets
+    const float ZOOM_STEP = 1.2f;
+    const float MIN_VIEW_WIDTH = 1.f;
+    const float MAX_VIEW_WIDTH = 1e6f;
+    sf::View camera;
+    bool panning = false;
+    sf::Vector2i pan_anchor;
+
+    // View culling: centers and half sizes of one kind of item, and their
+    // quadtree (refitted every frame, rebuilt when it gets loose)
+    struct CullSet {
+        std::vector<float> x, y, half_w, half_h;
+        ViewQuadtree tree;
+
+        void resize(size_t n) { x.resize(n); y.resize(n); half_w.resize(n); half_h.resize(n); }
+    };
+    CullSet body_cull, belt_cull, trail_cull;
+    std::vector<uint32_t> visible, clusters;
+
+    // Level of detail: nodes this many pixels across are one splat, bodies
+    // under a pixel are points
+    const float SPLAT_PIXELS = 2.f;
+    sf::VertexArray body_points;
+    sf::VertexArray splats;
 
     PhysicsWorld physics_world;
+    SubstepController substep_controller;   // energy / angular-momentum budget per frame
+    std::unique_ptr<ThreadPool> workers;   // force evaluation
 
 public:
     OrbitalChaosApp();
@@ -33,6 +86,18 @@ public:
 
 private:
     void setup_bodies();   // renamed from setup_planets
+    bool load_catalog();
+    void setup_belt();
     void update_trails();
     void render_trails();
+    void render_predictions();
+    void render_belt();
+    void render_bodies();
+    void append_splat(const ViewQuadtree::Node& node, sf::Color color, float pixel);
+    void cycle_field_overlay();
+
+    sf::FloatRect visible_area() const;
+    float pixel_size() const;
+    void zoom_camera(float steps, sf::Vector2i pixel);
+    void handle_camera_event(const sf::Event& event);
 };
\ No newline at end of file
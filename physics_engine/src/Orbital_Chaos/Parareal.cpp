@@ -0,0 +1,160 @@
+#include "Parareal.h"
+#include "../Common/ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// -------------Propagators----------------
+template <typename T>
+void Parareal<T>::setup_lane(Lane& lane, const Propagator& propagator, const std::vector<CelestialBody>& bodies)
+{
+    lane.world = World();
+    if (configure) configure(lane.world);
+    lane.world.set_thread_pool(nullptr);
+    lane.world.set_collisions(false);
+    lane.world.set_integrator(propagator.integrator);
+    lane.bodies = bodies;
+}
+
+template <typename T>
+double Parareal<T>::propagate(Lane& lane, const Propagator& propagator, const std::vector<T>& from, std::vector<T>& to, T dt)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    lane.world.set_state(lane.bodies, from);
+    const T h = dt / static_cast<T>(propagator.steps);
+    for (unsigned int s = 0; s < propagator.steps; s++)
+        lane.world.update_physics(lane.bodies, h);
+    lane.world.get_state(lane.bodies, to);
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// -------------Iteration----------------
+template <typename T>
+unsigned int Parareal<T>::integrate(std::vector<CelestialBody>& bodies, T duration)
+{
+    const unsigned int n = slices;
+    const T dt = duration / static_cast<T>(n);
+    const double converged = std::max(tolerance, ROUND_OFF * std::numeric_limits<T>::epsilon());
+
+    boundaries.assign(n + 1, {});
+    coarse_results.assign(n, {});
+    fine_results.assign(n, {});
+    fine_steps = 0;
+    defect = 0.0;
+    speedup = 0.0;
+    serial_slices = 0;
+
+    fine_lanes.resize(n);
+    for (Lane& lane : fine_lanes)
+        setup_lane(lane, fine, bodies);
+    setup_lane(coarse_lane, coarse, bodies);
+    coarse_lane.world.get_state(coarse_lane.bodies, boundaries[0]);
+
+    // Spread of positions and velocities around their means, for the defect
+    const std::vector<T>& start = boundaries[0];
+    const size_t count = start.size() / 4;
+    double scale[2] = { 0.0, 0.0 };
+    for (int part = 0; part < 2; part++) {
+        double mean_x = 0.0, mean_y = 0.0;
+        for (size_t i = 0; i < count; i++) {
+            mean_x += start[4 * i + 2 * part];
+            mean_y += start[4 * i + 2 * part + 1];
+        }
+        mean_x /= std::max<size_t>(count, 1);
+        mean_y /= std::max<size_t>(count, 1);
+        for (size_t i = 0; i < count; i++) {
+            scale[part] = std::max(scale[part], std::abs(start[4 * i + 2 * part] - mean_x));
+            scale[part] = std::max(scale[part], std::abs(start[4 * i + 2 * part + 1] - mean_y));
+        }
+        if (scale[part] == 0.0) scale[part] = 1.0;
+    }
+
+    // Seconds along the critical path (one core per slice), and the cost of
+    // one coarse and one fine slice
+    double critical = 0.0;
+    double coarse_time = 0.0;
+    double fine_time = 0.0;
+
+    // Iteration 0: coarse sweep
+    for (unsigned int s = 0; s < n; s++) {
+        coarse_time += propagate(coarse_lane, coarse, boundaries[s], coarse_results[s], dt);
+        boundaries[s + 1] = coarse_results[s];
+    }
+    critical += coarse_time;
+    coarse_time /= n;
+
+    unsigned int iterations = 0;
+    double previous_defect = 0.0;
+    std::vector<T> predicted;
+    std::vector<double> fine_times(n);
+
+    for (unsigned int k = 0; k < n && iterations < max_iterations; k++) {
+        // Fine propagations of the slices that are not final yet, in parallel
+        auto fine_slice = [&](size_t task) {
+            const unsigned int s = k + static_cast<unsigned int>(task);
+            fine_times[task] = propagate(fine_lanes[s], fine, boundaries[s], fine_results[s], dt);
+        };
+        if (pool && n - k > 1)
+            pool->parallelTasks(n - k, [&](size_t task, unsigned int) { fine_slice(task); });
+        else
+            for (size_t task = 0; task < n - k; task++) fine_slice(task);
+        fine_steps += static_cast<unsigned long long>(n - k) * fine.steps;
+
+        // The iteration waits for its slowest slice; the fastest one of the
+        // first iteration is the least disturbed estimate of a slice
+        critical += *std::max_element(fine_times.begin(), fine_times.begin() + (n - k));
+        if (k == 0) fine_time = *std::min_element(fine_times.begin(), fine_times.end());
+
+        // Sequential correction sweep; slice k starts from a final boundary,
+        // so its coarse result is unchanged
+        defect = 0.0;
+        for (unsigned int s = k; s < n; s++) {
+            if (s > k)
+                critical += propagate(coarse_lane, coarse, boundaries[s], predicted, dt);
+            else
+                predicted = coarse_results[s];
+
+            std::vector<T>& next = boundaries[s + 1];
+            for (size_t c = 0; c < next.size(); c++) {
+                T corrected = predicted[c] + fine_results[s][c] - coarse_results[s][c];
+                defect = std::max(defect, std::abs(double(corrected) - double(next[c])) / scale[(c / 2) % 2]);
+                next[c] = corrected;
+            }
+            coarse_results[s].swap(predicted);
+        }
+
+        iterations++;
+        if (defect <= converged) break;
+
+        // Iterations still needed at the contraction of the last one (at most
+        // one per slice left), against running the slices left serially
+        const unsigned int remaining = n - k - 1;
+        if (iterations >= 2 && remaining > 0) {
+            const double ratio = defect / previous_defect;
+            double more = remaining;
+            if (ratio < 1.0)
+                more = std::min(more, std::ceil(std::log(converged / defect) / std::log(ratio)));
+
+            if (more * (fine_time + remaining * coarse_time) >= remaining * fine_time) {
+                // Boundary k + 1 is final: the serial fine run from there
+                for (unsigned int s = k + 1; s < n; s++)
+                    critical += propagate(fine_lanes[s], fine, boundaries[s], boundaries[s + 1], dt);
+                fine_steps += static_cast<unsigned long long>(remaining) * fine.steps;
+                serial_slices = remaining;
+                break;
+            }
+        }
+        previous_defect = defect;
+    }
+
+    if (critical > 0.0)
+        speedup = n * fine_time / critical;
+
+    coarse_lane.world.set_state(bodies, boundaries[n]);
+    return iterations;
+}
+
+template class Parareal<float>;
+template class Parareal<double>;
@@ -0,0 +1,261 @@
+#include "ParticleMesh.h"
+#include "../Common/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+// -------------Setup----------------
+ParticleMesh::ParticleMesh(size_t nodes)
+    : mesh_size(0)
+{
+    set_mesh_size(nodes);
+}
+
+void ParticleMesh::set_mesh_size(size_t nodes)
+{
+    nodes = FFT2D::nextPowerOfTwo(std::max<size_t>(nodes, 4));
+    if (nodes == mesh_size) return;
+
+    mesh_size = nodes;
+    fft = FFT2D(2 * mesh_size, 2 * mesh_size);
+    kernel_x.clear();
+    kernel_y.clear();
+    kernel_potential.clear();
+}
+
+void ParticleMesh::set_potential(bool enabled)
+{
+    if (enabled == potential_solved) return;
+
+    potential_solved = enabled;
+    if (!enabled) {
+        kernel_potential.clear();
+        field_potential.clear();
+    }
+}
+
+// Field at offset d (in cells) of a unit mass, on the wrapped padded grid
+void ParticleMesh::build_kernel()
+{
+    const size_t width = fft.getWidth();
+    const size_t height = fft.getHeight();
+
+    kernel_x.assign(width * height, 0.0f);
+    kernel_y.assign(width * height, 0.0f);
+
+    for (size_t y = 0; y < height; y++) {
+        // Offsets wrap around: index n/2.. are negative offsets
+        float dy = y < height / 2 ? static_cast<float>(y) : static_cast<float>(y) - height;
+
+        for (size_t x = 0; x < width; x++) {
+            float dx = x < width / 2 ? static_cast<float>(x) : static_cast<float>(x) - width;
+            float r2 = dx * dx + dy * dy;
+            if (r2 == 0.0f) continue;
+
+            // Pulls the target (offset d from the source) back towards it
+            float inv_r3 = 1.0f / (r2 * std::sqrt(r2));
+            kernel_x[y * width + x] = -dx * inv_r3;
+            kernel_y[y * width + x] = -dy * inv_r3;
+        }
+    }
+
+    fft.forward(kernel_x);
+    fft.forward(kernel_y);
+}
+
+// Potential -1/|d| of a unit mass; the source cell gets the mean of 1/r
+// over a cell, 4 ln(1 + sqrt 2)
+void ParticleMesh::build_potential_kernel()
+{
+    const size_t width = fft.getWidth();
+    const size_t height = fft.getHeight();
+
+    kernel_potential.assign(width * height, 0.0f);
+    for (size_t y = 0; y < height; y++) {
+        float dy = y < height / 2 ? static_cast<float>(y) : static_cast<float>(y) - height;
+
+        for (size_t x = 0; x < width; x++) {
+            float dx = x < width / 2 ? static_cast<float>(x) : static_cast<float>(x) - width;
+            float r2 = dx * dx + dy * dy;
+            kernel_potential[y * width + x] = r2 == 0.0f ? -3.5254943f : -1.0f / std::sqrt(r2);
+        }
+    }
+
+    fft.forward(kernel_potential);
+}
+
+// -------------Solve----------------
+void ParticleMesh::build(const float* x, const float* y, const float* mass, size_t count)
+{
+    body_x = x;
+    body_y = y;
+    if (count == 0) return;
+
+    // Square mesh around the bounding box
+    float min_x = x[0], max_x = x[0], min_y = y[0], max_y = y[0];
+    for (size_t i = 1; i < count; i++) {
+        min_x = std::min(min_x, x[i]); max_x = std::max(max_x, x[i]);
+        min_y = std::min(min_y, y[i]); max_y = std::max(max_y, y[i]);
+    }
+    solve(mass, count, min_x, min_y, max_x, max_y);
+}
+
+void ParticleMesh::build(const float* x, const float* y, const float* mass, size_t count,
+    float min_x, float min_y, float max_x, float max_y)
+{
+    body_x = x;
+    body_y = y;
+
+    for (size_t i = 0; i < count; i++) {
+        min_x = std::min(min_x, x[i]); max_x = std::max(max_x, x[i]);
+        min_y = std::min(min_y, y[i]); max_y = std::max(max_y, y[i]);
+    }
+    solve(mass, count, min_x, min_y, max_x, max_y);
+}
+
+void ParticleMesh::solve(const float* mass, size_t count, float min_x, float min_y, float max_x, float max_y)
+{
+    // Kernels are built on first use, so worlds that never use the mesh
+    // do not pay for them
+    if (kernel_x.empty()) build_kernel();
+    if (potential_solved && kernel_potential.empty()) build_potential_kernel();
+
+    // The last node row and column only take the right CIC neighbours
+    const float extent = std::max({ max_x - min_x, max_y - min_y, 1e-3f });
+    cell_size = extent / static_cast<float>(mesh_size - 2);
+    origin_x = 0.5f * (min_x + max_x) - 0.5f * (mesh_size - 1) * cell_size;
+    origin_y = 0.5f * (min_y + max_y) - 0.5f * (mesh_size - 1) * cell_size;
+
+    // 1) Deposit: fixed body ranges into their own grids
+    const size_t nodes = mesh_size * mesh_size;
+    const size_t tasks = std::min(DEPOSIT_TASKS, count);
+    deposits.resize(tasks * nodes);
+
+    run_tasks(tasks, [&](size_t task) {
+        float* grid = deposits.data() + task * nodes;
+        std::fill(grid, grid + nodes, 0.0f);
+        deposit(count * task / tasks, count * (task + 1) / tasks, mass, grid);
+    });
+
+    // Sum the grids in task order into the padded density, row by row
+    const size_t width = fft.getWidth();
+    density.assign(width * fft.getHeight(), 0.0f);
+
+    run_tasks(DEPOSIT_TASKS, [&](size_t part) {
+        const size_t row_end = mesh_size * (part + 1) / DEPOSIT_TASKS;
+        for (size_t row = mesh_size * part / DEPOSIT_TASKS; row < row_end; row++) {
+            for (size_t col = 0; col < mesh_size; col++) {
+                float sum = 0.0f;
+                for (size_t task = 0; task < tasks; task++)
+                    sum += deposits[task * nodes + row * mesh_size + col];
+                density[row * width + col] = sum;
+            }
+        }
+    });
+
+    // 2) Convolution with the field kernel in Fourier space
+    fft.forward(density);
+    field_x.resize(density.size());
+    field_y.resize(density.size());
+    for (size_t k = 0; k < density.size(); k++) {
+        field_x[k] = density[k] * kernel_x[k];
+        field_y[k] = density[k] * kernel_y[k];
+    }
+    fft.inverse(field_x);
+    fft.inverse(field_y);
+
+    if (potential_solved) {
+        field_potential.resize(density.size());
+        for (size_t k = 0; k < density.size(); k++)
+            field_potential[k] = density[k] * kernel_potential[k];
+        fft.inverse(field_potential);
+    }
+}
+
+void ParticleMesh::deposit(size_t begin, size_t end, const float* mass, float* grid) const
+{
+    size_t ix, iy;
+    float fx, fy;
+
+    for (size_t i = begin; i < end; i++) {
+        weights(body_x[i], body_y[i], ix, iy, fx, fy);
+
+        float m = mass[i];
+        size_t node = iy * mesh_size + ix;
+        grid[node] += m * (1.f - fx) * (1.f - fy);
+        grid[node + 1] += m * fx * (1.f - fy);
+        grid[node + mesh_size] += m * (1.f - fx) * fy;
+        grid[node + mesh_size + 1] += m * fx * fy;
+    }
+}
+
+// 3) Interpolation with the deposit weights (no self-force, momentum conserving)
+void ParticleMesh::accelerations(size_t begin, size_t end, float G, float* ax, float* ay) const
+{
+    const size_t width = fft.getWidth();
+
+    // The kernel is in cell units: a = G m d / |d|^3 scales with 1 / h^2
+    const float scale = G / (cell_size * cell_size);
+
+    size_t ix, iy;
+    float fx, fy;
+    for (size_t i = begin; i < end; i++) {
+        weights(body_x[i], body_y[i], ix, iy, fx, fy);
+
+        size_t node = iy * width + ix;
+        float w00 = (1.f - fx) * (1.f - fy), w10 = fx * (1.f - fy);
+        float w01 = (1.f - fx) * fy, w11 = fx * fy;
+
+        ax[i] = scale * (w00 * field_x[node].real() + w10 * field_x[node + 1].real()
+            + w01 * field_x[node + width].real() + w11 * field_x[node + width + 1].real());
+        ay[i] = scale * (w00 * field_y[node].real() + w10 * field_y[node + 1].real()
+            + w01 * field_y[node + width].real() + w11 * field_y[node + width + 1].real());
+    }
+}
+
+void ParticleMesh::sample(float x, float y, float G, float& potential, float& ax, float& ay) const
+{
+    const size_t width = fft.getWidth();
+    const float scale = G / (cell_size * cell_size);
+
+    size_t ix, iy;
+    float fx, fy;
+    weights(x, y, ix, iy, fx, fy);
+
+    size_t node = iy * width + ix;
+    float w00 = (1.f - fx) * (1.f - fy), w10 = fx * (1.f - fy);
+    float w01 = (1.f - fx) * fy, w11 = fx * fy;
+
+    ax = scale * (w00 * field_x[node].real() + w10 * field_x[node + 1].real()
+        + w01 * field_x[node + width].real() + w11 * field_x[node + width + 1].real());
+    ay = scale * (w00 * field_y[node].real() + w10 * field_y[node + 1].real()
+        + w01 * field_y[node + width].real() + w11 * field_y[node + width + 1].real());
+
+    // Potential scales with 1 / h
+    potential = !potential_solved ? 0.f : G / cell_size * (w00 * field_potential[node].real()
+        + w10 * field_potential[node + 1].real() + w01 * field_potential[node + width].real()
+        + w11 * field_potential[node + width + 1].real());
+}
+
+void ParticleMesh::weights(float x, float y, size_t& ix, size_t& iy, float& fx, float& fy) const
+{
+    const float last = static_cast<float>(mesh_size - 2);
+    float gx = std::clamp((x - origin_x) / cell_size, 0.0f, last);
+    float gy = std::clamp((y - origin_y) / cell_size, 0.0f, last);
+
+    ix = std::min(static_cast<size_t>(gx), mesh_size - 2);
+    iy = std::min(static_cast<size_t>(gy), mesh_size - 2);
+    fx = gx - static_cast<float>(ix);
+    fy = gy - static_cast<float>(iy);
+}
+
+template <typename Job>
+void ParticleMesh::run_tasks(size_t count, const Job& job)
+{
+    if (pool && count > 1) {
+        pool->parallelTasks(count, [&](size_t task, unsigned int) { job(task); });
+        return;
+    }
+
+    for (size_t task = 0; task < count; task++)
+        job(task);
+}
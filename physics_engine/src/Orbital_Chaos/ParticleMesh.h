@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "../Common/FFT.h"
+
+class ThreadPool;
+
+// Particle-mesh gravity for very large N.
+// Every build() fits a square mesh of mesh_size^2 nodes around the bodies,
+// then:
+//  1) cloud-in-cell mass assignment; fixed body ranges deposit into their own
+//     grids, which are summed in a fixed order (deterministic for any
+//     thread count)
+//  2) FFT convolution with the field kernel -d/|d|^3, on a grid zero-padded
+//     to twice the mesh so there are no periodic images
+//  3) cloud-in-cell interpolation of the field back to the bodies
+// The kernel is built by the first build() for a mesh size, in cell units;
+// the cell size only scales the result. Forces are smoothed below about two
+// cells, so resolution is traded for O(N + M log M) cost. Far outliers
+// stretch the mesh and coarsen it for everyone.
+class ParticleMesh
+{
+public:
+    explicit ParticleMesh(size_t mesh_size = 256);
+
+    // Nodes per side (rounded up to a power of two, at least 4)
+    void set_mesh_size(size_t nodes);
+    size_t get_mesh_size() const { return mesh_size; }
+
+    // nullptr = deposit on the calling thread
+    void set_thread_pool(ThreadPool* p) { pool = p; }
+
+    // Also solve for the potential (one more convolution per build)
+    void set_potential(bool enabled);
+
+    // Deposit the bodies and solve for the mesh field
+    void build(const float* x, const float* y, const float* mass, size_t count);
+    // Same, with the mesh also covering the rectangle [min, max] (to sample
+    // the field there)
+    void build(const float* x, const float* y, const float* mass, size_t count,
+        float min_x, float min_y, float max_x, float max_y);
+
+    // Accelerations of bodies [begin, end) of the last build (reads the
+    // positions passed to build)
+    void accelerations(size_t begin, size_t end, float G, float* ax, float* ay) const;
+
+    // Field of the last build at a point inside the mesh (potential 0
+    // unless it is solved)
+    void sample(float x, float y, float G, float& potential, float& ax, float& ay) const;
+
+    // Cell size of the last build
+    float get_cell_size() const { return cell_size; }
+
+private:
+    static const size_t DEPOSIT_TASKS = 8;
+
+    size_t mesh_size;
+    FFT2D fft;
+    std::vector<FFT2D::Complex> kernel_x;   // FFT of the field kernel
+    std::vector<FFT2D::Complex> kernel_y;
+    std::vector<FFT2D::Complex> density;
+    std::vector<FFT2D::Complex> field_x;
+    std::vector<FFT2D::Complex> field_y;
+    bool potential_solved = false;
+    std::vector<FFT2D::Complex> kernel_potential;
+    std::vector<FFT2D::Complex> field_potential;
+
+    // Per-task deposit grids (mesh_size^2 each)
+    std::vector<float> deposits;
+
+    // Mesh placement and the bodies of the last build
+    float origin_x = 0.f, origin_y = 0.f;
+    float cell_size = 1.f;
+    const float* body_x = nullptr;
+    const float* body_y = nullptr;
+
+    ThreadPool* pool = nullptr;
+
+    void build_kernel();
+    void build_potential_kernel();
+    void solve(const float* mass, size_t count, float min_x, float min_y, float max_x, float max_y);
+    void deposit(size_t begin, size_t end, const float* mass, float* grid) const;
+
+    // Cloud-in-cell weights of a position on the mesh
+    void weights(float x, float y, size_t& ix, size_t& iy, float& fx, float& fy) const;
+
+    template <typename Job>
+    void run_tasks(size_t count, const Job& job);
+};
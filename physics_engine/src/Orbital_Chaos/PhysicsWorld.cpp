@@ -1,65 +1,712 @@
 #include "PhysicsWorld.h"
+#include "GravityKernels.h"
+#include "../Common/ThreadPool.h"
+#include <algorithm>
 #include <cmath>
+#include <type_traits>
 #include <vector>
 
-void PhysicsWorld::update_physics(std::vector<CelestialBody>& bodies, float dt)
+namespace {
+    const float EPSILON = 1e-5f; // Small value to avoid singularity
+
+    // Below this the pair-symmetric scalar loop beats the full SIMD sum
+    const size_t SIMD_MIN_BODIES = 64;
+
+    // Targets per task (a multiple of the SIMD block, so task boundaries
+    // never change which targets take the scalar tail)
+    const size_t TASK_BODIES = 256;
+
+    // Pair-symmetric loop: fixed number of row tasks above this size
+    const size_t PAIR_TASK_MIN_BODIES = 256;
+    const size_t PAIR_TASKS = 32;
+}
+
+// -------------Integrators----------------
+namespace {
+    struct Stage {
+        bool drift;     // drift x += c dt v, otherwise kick v += c dt a
+        double coeff;
+    };
+
+    // Kick-drift-kick composition of Verlet steps of length w[k] dt
+    std::vector<Stage> compose_kdk(const std::vector<double>& w)
+    {
+        std::vector<Stage> stages;
+        double kick = 0.0;
+        for (double wk : w) {
+            stages.push_back({ false, kick + 0.5 * wk });
+            stages.push_back({ true, wk });
+            kick = 0.5 * wk;
+        }
+        stages.push_back({ false, kick });
+        return stages;
+    }
+
+    const std::vector<Stage>& stages_for(Integrator integrator)
+    {
+        // Triple jump: 2 x0 + x1 = 1 with x0 = 1 / (2 - 2^(1/3))
+        static const double cbrt2 = std::cbrt(2.0);
+        static const double x0 = 1.0 / (2.0 - cbrt2);
+        static const double x1 = -cbrt2 / (2.0 - cbrt2);
+
+        static const std::vector<Stage> verlet = compose_kdk({ 1.0 });
+        static const std::vector<Stage> yoshida4 = compose_kdk({ x0, x1, x0 });
+
+        // Yoshida (1990) 6th order, solution A
+        static const double w1 = -1.17767998417887, w2 = 0.235573213359357, w3 = 0.784513610477560;
+        static const double w0 = 1.0 - 2.0 * (w1 + w2 + w3);
+        static const std::vector<Stage> yoshida6 = compose_kdk({ w3, w2, w1, w0, w1, w2, w3 });
+
+        // Forest & Ruth (1990): the triple jump, drift first
+        static const std::vector<Stage> forest_ruth = {
+            { true, 0.5 * x0 }, { false, x0 }, { true, 0.5 * (x0 + x1) }, { false, x1 },
+            { true, 0.5 * (x0 + x1) }, { false, x0 }, { true, 0.5 * x0 }
+        };
+
+        // Omelyan, Mryglod & Folk (2002) position-extended Forest-Ruth-like
+        static const double xi = 0.1786178958448091, lambda = -0.2123418310626054, chi = -0.06626458266981849;
+        static const std::vector<Stage> pefrl = {
+            { true, xi }, { false, 0.5 * (1.0 - 2.0 * lambda) }, { true, chi }, { false, lambda },
+            { true, 1.0 - 2.0 * (chi + xi) }, { false, lambda }, { true, chi },
+            { false, 0.5 * (1.0 - 2.0 * lambda) }, { true, xi }
+        };
+
+        switch (integrator) {
+        case Integrator::ForestRuth: return forest_ruth;
+        case Integrator::PEFRL: return pefrl;
+        case Integrator::Yoshida4: return yoshida4;
+        case Integrator::Yoshida6: return yoshida6;
+        default: return verlet;
+        }
+    }
+}
+
+const char* integrator_name(Integrator integrator)
 {
-    // Vectors for pairwise distances, accelerations, and temporary positions
-    sf::Vector2f r_ij;
-    sf::Vector2f r_ij_new;
-    std::vector<sf::Vector2f> accel(bodies.size(), { 0.f, 0.f });      // old accelerations
-    std::vector<sf::Vector2f> accel_new(bodies.size(), { 0.f, 0.f });  // new accelerations
-    std::vector<sf::Vector2f> pos_new(bodies.size(), { 0.f, 0.f });    // new positions
+    switch (integrator) {
+    case Integrator::ForestRuth: return "Forest-Ruth";
+    case Integrator::PEFRL: return "PEFRL";
+    case Integrator::Yoshida4: return "Yoshida 4";
+    case Integrator::Yoshida6: return "Yoshida 6";
+    case Integrator::WisdomHolman: return "Wisdom-Holman";
+    case Integrator::HermiteBlock: return "Hermite block";
+    default: return "Velocity Verlet";
+    }
+}
 
-    const float EPSILON = 1e-5f; // Small value to avoid singularity
+int integrator_order(Integrator integrator)
+{
+    switch (integrator) {
+    case Integrator::VelocityVerlet: return 2;
+    case Integrator::Yoshida6: return 6;
+    case Integrator::WisdomHolman: return 2;   // times the planet / star mass ratio
+    default: return 4;
+    }
+}
+
+template <typename T>
+void BasicPhysicsWorld<T>::update_physics(std::vector<CelestialBody>& bodies, T dt)
+{
+    const size_t n = bodies.size();
+
+    removed_bodies.clear();
+    sync(bodies);
+
+    // Test particles: kick-drift-kick around the step of the bodies
+    // (the splitting schemes move them stage by stage instead)
+    const bool leapfrog_tests = integrator == Integrator::HermiteBlock || integrator == Integrator::WisdomHolman;
+    if (leapfrog_tests)
+        kick_test_particles(dt / 2);
+
+    if (integrator == Integrator::HermiteBlock) {
+        block.step(pos_x.data(), pos_y.data(), vel_x.data(), vel_y.data(), masses.data(), n,
+            dt, static_cast<T>(PhysicsConstants::G), static_cast<T>(EPSILON));
+        accel_valid = false;
+    }
+    else if (integrator == Integrator::WisdomHolman) {
+        wisdom_holman.step(pos_x.data(), pos_y.data(), vel_x.data(), vel_y.data(), masses.data(), n,
+            dt, PhysicsConstants::G, EPSILON);
+        accel_valid = false;
+    }
+    else {
+        splitting_step(dt);
+    }
 
-    // 1) Compute current accelerations
-    for (size_t i = 0; i < bodies.size(); i++) {
-        for (size_t j = 0; j < bodies.size(); j++) {
-            if (i == j) continue;  // skip self-interaction
+    if (leapfrog_tests) {
+        test_particles.drift(dt);
+        kick_test_particles(dt / 2);
+    }
+
+    // Bodies get the state rounded to float
+    for (size_t i = 0; i < n; i++) {
+        bodies[i].set_position({ static_cast<float>(pos_x[i]), static_cast<float>(pos_y[i]) });
+        bodies[i].set_velocity({ static_cast<float>(vel_x[i]), static_cast<float>(vel_y[i]) });
+    }
+
+    if (collisions)
+        merge_collisions(bodies);
+}
+
+// One step of the active splitting scheme on the SoA state
+template <typename T>
+void BasicPhysicsWorld<T>::splitting_step(T dt)
+{
+    const size_t n = pos_x.size();
+
+    // Close pairs are fixed for the whole step; their members get other
+    // accelerations, so the cached ones only hold for the same pairs
+    if (regularization) {
+        if (close_encounters.find_pairs(pos_x.data(), pos_y.data(), masses.data(), n, dt, PhysicsConstants::G))
+            accel_valid = false;
+    }
+    else if (!close_encounters.empty()) {
+        close_encounters.clear();
+        accel_valid = false;
+    }
+    const bool pairs = !close_encounters.empty();
 
-            r_ij = bodies[j].get_position() - bodies[i].get_position();
-            float dist = std::sqrt(r_ij.x * r_ij.x + r_ij.y * r_ij.y);
+    for (const Stage& stage : stages_for(integrator)) {
+        const T h = static_cast<T>(stage.coeff) * dt;
 
-            if (dist < EPSILON) continue; // avoid singularity / divide by zero
+        if (stage.drift) {
+            // Pair members drift with their pair
+            if (compensated) {
+                // Kahan: comp holds the low-order bits lost by the last sum
+                for (size_t i = 0; i < n; i++) {
+                    if (pairs && close_encounters.is_paired(i)) continue;
 
-            float invDist3 = 1.0f / (dist * dist * dist);
-            float accel_mag = PhysicsConstants::G * bodies[j].get_mass() * invDist3;
+                    T step_x = vel_x[i] * h - comp_x[i];
+                    T sum_x = pos_x[i] + step_x;
+                    comp_x[i] = (sum_x - pos_x[i]) - step_x;
+                    pos_x[i] = sum_x;
 
-            accel[i] += r_ij * accel_mag;  // accumulate acceleration
+                    T step_y = vel_y[i] * h - comp_y[i];
+                    T sum_y = pos_y[i] + step_y;
+                    comp_y[i] = (sum_y - pos_y[i]) - step_y;
+                    pos_y[i] = sum_y;
+                }
+            }
+            else {
+                for (size_t i = 0; i < n; i++) {
+                    if (pairs && close_encounters.is_paired(i)) continue;
+
+                    pos_x[i] += vel_x[i] * h;
+                    pos_y[i] += vel_y[i] * h;
+                }
+            }
+            if (pairs) {
+                close_encounters.drift(pos_x.data(), pos_y.data(), vel_x.data(), vel_y.data(), masses.data(),
+                    h, PhysicsConstants::G);
+                for (const auto& pair : close_encounters.get_pairs()) {
+                    comp_x[pair.first] = comp_y[pair.first] = T(0);
+                    comp_x[pair.second] = comp_y[pair.second] = T(0);
+                }
+            }
+
+            test_particles.drift(h);
+            accel_valid = false;
+            continue;
+        }
+
+        if (!accel_valid) {
+            compute_accelerations(solver, acc_x.data(), acc_y.data());
+            if (pairs)
+                close_encounters.external_accelerations(pos_x.data(), pos_y.data(), masses.data(), n,
+                    PhysicsConstants::G, EPSILON, acc_x.data(), acc_y.data());
+            force_evaluations++;
+            body_evaluations += n;
+            accel_valid = true;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            vel_x[i] += acc_x[i] * h;
+            vel_y[i] += acc_y[i] * h;
         }
+        kick_test_particles(h);
     }
+}
+
+// Against the bodies at their current state
+template <typename T>
+void BasicPhysicsWorld<T>::kick_test_particles(T h)
+{
+    test_particles.kick(h, pos_x.data(), pos_y.data(), masses.data(), pos_x.size(),
+        static_cast<T>(PhysicsConstants::G), static_cast<T>(EPSILON));
+}
+
+// -------------Collisions----------------
+// Overlaps are checked at the end of the step, so bodies fast enough to cross
+// each other within one step can still pass through
+template <typename T>
+void BasicPhysicsWorld<T>::merge_collisions(std::vector<CelestialBody>& bodies)
+{
+    const size_t n = bodies.size();
+    radii.resize(n);
+    for (size_t i = 0; i < n; i++)
+        radii[i] = bodies[i].get_radius();
 
-    // 2) Compute new positions
-    for (size_t i = 0; i < bodies.size(); i++) {
-        pos_new[i] = bodies[i].get_position() +
-            bodies[i].get_velocity() * dt +
-            0.5f * accel[i] * dt * dt;
+    spatial_hash.find_overlaps(pos_x.data(), pos_y.data(), radii.data(), n, overlaps);
+    if (overlaps.empty()) return;
+
+    // Union-find: chains of touching bodies form one group, rooted at its
+    // lowest index
+    merge_group.resize(n);
+    for (size_t i = 0; i < n; i++)
+        merge_group[i] = static_cast<uint32_t>(i);
+
+    auto root = [&](uint32_t i) {
+        while (merge_group[i] != i)
+            i = merge_group[i] = merge_group[merge_group[i]];
+        return i;
+    };
+
+    merge_members.clear();
+    for (const auto& pair : overlaps) {
+        uint32_t a = root(pair.first), b = root(pair.second);
+        merge_group[std::max(a, b)] = std::min(a, b);
+        merge_members.push_back(pair.first);
+        merge_members.push_back(pair.second);
     }
 
-    // 3) Compute new accelerations at new positions
-    for (size_t i = 0; i < bodies.size(); i++) {
-        for (size_t j = 0; j < bodies.size(); j++) {
-            if (i == j) continue;
+    // Members by group, in index order within a group
+    std::sort(merge_members.begin(), merge_members.end());
+    merge_members.erase(std::unique(merge_members.begin(), merge_members.end()), merge_members.end());
+    std::stable_sort(merge_members.begin(), merge_members.end(),
+        [&](uint32_t a, uint32_t b) { return root(a) < root(b); });
 
-            r_ij_new = pos_new[j] - pos_new[i];
-            float dist = std::sqrt(r_ij_new.x * r_ij_new.x + r_ij_new.y * r_ij_new.y);
+    merge_removed.assign(n, false);
+    for (size_t first = 0; first < merge_members.size(); ) {
+        size_t last = first + 1;
+        while (last < merge_members.size() && root(merge_members[last]) == root(merge_members[first]))
+            last++;
 
-            if (dist < EPSILON) continue;
+        // The heaviest body survives (the lowest index on ties)
+        uint32_t survivor = merge_members[first];
+        double mass = 0.0, mx = 0.0, my = 0.0, px = 0.0, py = 0.0, volume = 0.0;
+        for (size_t k = first; k < last; k++) {
+            uint32_t i = merge_members[k];
+            if (masses[i] > masses[survivor]) survivor = i;
+
+            double m = masses[i];
+            mass += m;
+            mx += m * pos_x[i];
+            my += m * pos_y[i];
+            px += m * vel_x[i];
+            py += m * vel_y[i];
+            volume += double(radii[i]) * radii[i] * radii[i];
+        }
+
+        for (size_t k = first; k < last; k++)
+            merge_removed[merge_members[k]] = merge_members[k] != survivor;
+
+        // Centre of mass and its velocity (massless groups keep the survivor's)
+        if (mass > 0.0) {
+            pos_x[survivor] = static_cast<T>(mx / mass);
+            pos_y[survivor] = static_cast<T>(my / mass);
+            vel_x[survivor] = static_cast<T>(px / mass);
+            vel_y[survivor] = static_cast<T>(py / mass);
+        }
+        masses[survivor] = static_cast<T>(mass);
+        comp_x[survivor] = T(0);
+        comp_y[survivor] = T(0);
+
+        CelestialBody& body = bodies[survivor];
+        body.set_position({ static_cast<float>(pos_x[survivor]), static_cast<float>(pos_y[survivor]) });
+        body.set_velocity({ static_cast<float>(vel_x[survivor]), static_cast<float>(vel_y[survivor]) });
+        body.set_mass(static_cast<float>(mass));
+        body.set_radius(static_cast<float>(std::cbrt(volume)));
+
+        first = last;
+    }
+
+    // Erase the absorbed bodies, keeping the order of the others
+    size_t kept = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (merge_removed[i]) {
+            removed_bodies.push_back(i);
+            continue;
+        }
+        if (kept != i) {
+            bodies[kept] = std::move(bodies[i]);
+            pos_x[kept] = pos_x[i]; pos_y[kept] = pos_y[i];
+            vel_x[kept] = vel_x[i]; vel_y[kept] = vel_y[i];
+            masses[kept] = masses[i];
+            comp_x[kept] = comp_x[i]; comp_y[kept] = comp_y[i];
+        }
+        kept++;
+    }
+
+    bodies.erase(bodies.begin() + kept, bodies.end());
+    for (std::vector<T>* v : { &pos_x, &pos_y, &vel_x, &vel_y, &masses, &acc_x, &acc_y, &comp_x, &comp_y })
+        v->resize(kept);
+
+    accel_valid = false;
+    block.reset();
+    wisdom_holman.reset();
+    test_particles.invalidate();
+}
+
+// Cached accelerations and integrator state stay valid while nobody else
+// moved, added or re-weighted a body
+template <typename T>
+void BasicPhysicsWorld<T>::sync(const std::vector<CelestialBody>& bodies)
+{
+    if (gather(bodies)) return;
+
+    accel_valid = false;
+    block.reset();
+    wisdom_holman.reset();
+    test_particles.invalidate();
+}
+
+template <typename T>
+void BasicPhysicsWorld<T>::get_state(const std::vector<CelestialBody>& bodies, std::vector<T>& state)
+{
+    sync(bodies);
+
+    const size_t n = pos_x.size();
+    state.resize(4 * n);
+    for (size_t i = 0; i < n; i++) {
+        state[4 * i] = pos_x[i];
+        state[4 * i + 1] = pos_y[i];
+        state[4 * i + 2] = vel_x[i];
+        state[4 * i + 3] = vel_y[i];
+    }
+}
+
+template <typename T>
+void BasicPhysicsWorld<T>::set_state(std::vector<CelestialBody>& bodies, const std::vector<T>& state)
+{
+    sync(bodies);
 
-            float invDist3 = 1.0f / (dist * dist * dist);
-            float accel_mag_new = PhysicsConstants::G * bodies[j].get_mass() * invDist3;
+    const size_t n = std::min(pos_x.size(), state.size() / 4);
+    for (size_t i = 0; i < n; i++) {
+        pos_x[i] = state[4 * i];
+        pos_y[i] = state[4 * i + 1];
+        vel_x[i] = state[4 * i + 2];
+        vel_y[i] = state[4 * i + 3];
+        comp_x[i] = T(0);
+        comp_y[i] = T(0);
 
-            accel_new[i] += r_ij_new * accel_mag_new;
+        bodies[i].set_position({ static_cast<float>(pos_x[i]), static_cast<float>(pos_y[i]) });
+        bodies[i].set_velocity({ static_cast<float>(vel_x[i]), static_cast<float>(vel_y[i]) });
+    }
+
+    accel_valid = false;
+    block.reset();
+    wisdom_holman.reset();
+    test_particles.invalidate();
+}
+
+// Copy the bodies into the SoA state; false if anything differs from it
+// (compared at float precision, the precision the bodies hold)
+template <typename T>
+bool BasicPhysicsWorld<T>::gather(const std::vector<CelestialBody>& bodies)
+{
+    const size_t n = bodies.size();
+    bool unchanged = pos_x.size() == n;
+
+    if (!unchanged) {
+        pos_x.resize(n); pos_y.resize(n);
+        vel_x.resize(n); vel_y.resize(n);
+        masses.resize(n);
+        acc_x.resize(n); acc_y.resize(n);
+        comp_x.assign(n, T(0)); comp_y.assign(n, T(0));
+    }
+
+    auto rounded = [](T value) { return static_cast<float>(value); };
+
+    for (size_t i = 0; i < n; i++) {
+        sf::Vector2f p = bodies[i].get_position();
+        float m = bodies[i].get_mass();
+        sf::Vector2f v = bodies[i].get_velocity();
+        if (p.x != rounded(pos_x[i]) || p.y != rounded(pos_y[i]) || m != rounded(masses[i])
+            || v.x != rounded(vel_x[i]) || v.y != rounded(vel_y[i])) {
+            pos_x[i] = p.x;
+            pos_y[i] = p.y;
+            vel_x[i] = v.x;
+            vel_y[i] = v.y;
+            masses[i] = m;
+            comp_x[i] = T(0);
+            comp_y[i] = T(0);
+            unchanged = false;
+        }
+    }
+
+    return unchanged;
+}
+
+// -------------Forces----------------
+template <typename T>
+void BasicPhysicsWorld<T>::compute_accelerations(GravitySolver method, T* ax, T* ay)
+{
+    const size_t n = pos_x.size();
+    const size_t tasks = (n + TASK_BODIES - 1) / TASK_BODIES;
+    pair_potential_valid = false;
+
+    if (method != GravitySolver::Direct) {
+        approximate_accelerations(method, ax, ay);
+        return;
+    }
+
+    // The SIMD kernels are single precision
+    if constexpr (std::is_same_v<T, float>) {
+        if (n >= SIMD_MIN_BODIES && GravityKernels::detect_isa() != GravityKernels::Isa::Scalar) {
+            run_tasks(tasks, [&](size_t task) {
+                GravityKernels::direct_accelerations(pos_x.data(), pos_y.data(), masses.data(), n,
+                    task * TASK_BODIES, std::min(n, (task + 1) * TASK_BODIES), PhysicsConstants::G, EPSILON, ax, ay);
+            });
+            return;
+        }
+    }
+
+    pair_accelerations(ax, ay);
+}
+
+// The tree and the mesh are approximations anyway: they work in float, and
+// double state goes through float copies
+template <typename T>
+void BasicPhysicsWorld<T>::approximate_accelerations(GravitySolver method, T* ax, T* ay)
+{
+    const size_t n = pos_x.size();
+    const size_t tasks = (n + TASK_BODIES - 1) / TASK_BODIES;
+
+    const float *x, *y, *m;
+    float *out_x, *out_y;
+    if constexpr (std::is_same_v<T, float>) {
+        x = pos_x.data(); y = pos_y.data(); m = masses.data();
+        out_x = ax; out_y = ay;
+    }
+    else {
+        single_x.assign(pos_x.begin(), pos_x.end());
+        single_y.assign(pos_y.begin(), pos_y.end());
+        single_mass.assign(masses.begin(), masses.end());
+        single_ax.resize(n);
+        single_ay.resize(n);
+        x = single_x.data(); y = single_y.data(); m = single_mass.data();
+        out_x = single_ax.data(); out_y = single_ay.data();
+    }
+
+    if (method == GravitySolver::BarnesHut) {
+        tree.build(x, y, m, n);
+        run_tasks(tasks, [&](size_t task) {
+            tree.accelerations(task * TASK_BODIES, std::min(n, (task + 1) * TASK_BODIES),
+                PhysicsConstants::G, EPSILON, out_x, out_y);
+        });
+    }
+    else {
+        mesh.build(x, y, m, n);
+        run_tasks(tasks, [&](size_t task) {
+            mesh.accelerations(task * TASK_BODIES, std::min(n, (task + 1) * TASK_BODIES),
+                PhysicsConstants::G, out_x, out_y);
+        });
+    }
+
+    if constexpr (!std::is_same_v<T, float>) {
+        for (size_t i = 0; i < n; i++) {
+            ax[i] = single_ax[i];
+            ay[i] = single_ay[i];
         }
     }
+}
 
-    // 4) Update velocities and positions
-    for (size_t i = 0; i < bodies.size(); i++) {
-        // Velocity Verlet update
-        sf::Vector2f v_new = bodies[i].get_velocity() + 0.5f * (accel[i] + accel_new[i]) * dt;
+// Templated rather than std::function: the force lambdas capture too much
+// for its small buffer and would allocate on every evaluation
+template <typename T>
+template <typename Job>
+void BasicPhysicsWorld<T>::run_tasks(size_t count, const Job& job)
+{
+    if (pool && count > 1) {
+        pool->parallelTasks(count, [&](size_t task, unsigned int) { job(task); });
+        return;
+    }
+
+    for (size_t task = 0; task < count; task++)
+        job(task);
+}
 
-        bodies[i].set_position(pos_new[i]);
-        bodies[i].set_velocity(v_new);
+// Each pair once: equal and opposite contributions (Newton's third law).
+// The potential energy comes almost for free with the pair terms.
+template <typename T>
+void BasicPhysicsWorld<T>::pair_accelerations(T* ax, T* ay)
+{
+    const size_t n = pos_x.size();
+    pair_potential_valid = true;
+    if (n < PAIR_TASK_MIN_BODIES) {
+        pair_rows(0, n, ax, ay, pair_potential);
+        return;
     }
-}
\ No newline at end of file
+
+    // Row ranges with equal pair counts (row i has n - 1 - i pairs)
+    if (pair_task_rows.size() != PAIR_TASKS + 1 || pair_task_rows.back() != n) {
+        pair_task_rows.assign(PAIR_TASKS + 1, n);
+        pair_task_rows[0] = 0;
+
+        const double total = 0.5 * static_cast<double>(n) * (n - 1);
+        double pairs = 0.0;
+        size_t task = 1;
+        for (size_t i = 0; i < n && task < PAIR_TASKS; i++) {
+            pairs += static_cast<double>(n - 1 - i);
+            while (task < PAIR_TASKS && pairs >= total * task / PAIR_TASKS)
+                pair_task_rows[task++] = i + 1;
+        }
+
+        pair_acc_x.resize(PAIR_TASKS * n);
+        pair_acc_y.resize(PAIR_TASKS * n);
+        pair_task_potential.resize(PAIR_TASKS);
+    }
+
+    // Task k only touches bodies from its first row on
+    run_tasks(PAIR_TASKS, [&](size_t task) {
+        pair_rows(pair_task_rows[task], pair_task_rows[task + 1],
+            pair_acc_x.data() + task * n, pair_acc_y.data() + task * n, pair_task_potential[task]);
+    });
+
+    pair_potential = 0.0;
+    for (double task_potential : pair_task_potential)
+        pair_potential += task_potential;
+
+    // Fixed-order reduction over the tasks
+    run_tasks((n + TASK_BODIES - 1) / TASK_BODIES, [&](size_t chunk) {
+        const size_t end = std::min(n, (chunk + 1) * TASK_BODIES);
+        for (size_t i = chunk * TASK_BODIES; i < end; i++) {
+            T sum_x = T(0), sum_y = T(0);
+            for (size_t task = 0; task < PAIR_TASKS && pair_task_rows[task] <= i; task++) {
+                sum_x += pair_acc_x[task * n + i];
+                sum_y += pair_acc_y[task * n + i];
+            }
+            ax[i] = sum_x;
+            ay[i] = sum_y;
+        }
+    });
+}
+
+// Pairs (i, j > i) for rows [row_begin, row_end); writes bodies [row_begin, n)
+// and the potential energy of these pairs
+template <typename T>
+void BasicPhysicsWorld<T>::pair_rows(size_t row_begin, size_t row_end, T* ax, T* ay, double& potential) const
+{
+    const size_t n = pos_x.size();
+    for (size_t i = row_begin; i < n; i++) {
+        ax[i] = T(0);
+        ay[i] = T(0);
+    }
+    potential = 0.0;
+
+    for (size_t i = row_begin; i < row_end; i++) {
+        T axi = T(0), ayi = T(0);
+        double row_potential = 0.0;    // G m_j / r_ij
+
+        for (size_t j = i + 1; j < n; j++) {
+            T dx = pos_x[j] - pos_x[i];
+            T dy = pos_y[j] - pos_y[i];
+            T dist = std::sqrt(dx * dx + dy * dy);
+
+            if (dist < static_cast<T>(EPSILON)) continue; // avoid singularity / divide by zero
+
+            T invDist3 = static_cast<T>(PhysicsConstants::G) / (dist * dist * dist);
+            T to_i = masses[j] * invDist3;
+            T to_j = masses[i] * invDist3;
+
+            axi += dx * to_i;
+            ayi += dy * to_i;
+            ax[j] -= dx * to_j;
+            ay[j] -= dy * to_j;
+            row_potential += double(to_i) * double(dx * dx + dy * dy);
+        }
+
+        ax[i] += axi;
+        ay[i] += ayi;
+        potential -= double(masses[i]) * row_potential;
+    }
+}
+
+template <typename T>
+float BasicPhysicsWorld<T>::measure_force_error(const std::vector<CelestialBody>& bodies)
+{
+    sync(bodies);
+
+    const size_t n = bodies.size();
+    std::vector<T> ref_x(n), ref_y(n), approx_x(n), approx_y(n);
+    compute_accelerations(GravitySolver::Direct, ref_x.data(), ref_y.data());
+    compute_accelerations(solver, approx_x.data(), approx_y.data());
+
+    double sum = 0.0;
+    size_t counted = 0;
+    for (size_t i = 0; i < n; i++) {
+        double dx = approx_x[i] - ref_x[i];
+        double dy = approx_y[i] - ref_y[i];
+        double ref2 = double(ref_x[i]) * ref_x[i] + double(ref_y[i]) * ref_y[i];
+        if (ref2 == 0.0) continue;
+
+        sum += (dx * dx + dy * dy) / ref2;
+        counted++;
+    }
+
+    return counted ? static_cast<float>(std::sqrt(sum / counted)) : 0.f;
+}
+
+template <typename T>
+double BasicPhysicsWorld<T>::total_energy(const std::vector<CelestialBody>& bodies)
+{
+    // From the full-precision state while the bodies still match it
+    sync(bodies);
+
+    const size_t n = pos_x.size();
+    double kinetic = 0.0;
+    for (size_t i = 0; i < n; i++)
+        kinetic += 0.5 * double(masses[i]) * (double(vel_x[i]) * vel_x[i] + double(vel_y[i]) * vel_y[i]);
+
+    // Reuse the potential of the last direct evaluation while the positions
+    // have not moved since (a kick-last step leaves it current), or the one
+    // of the last Wisdom-Holman kick
+    if (accel_valid && pair_potential_valid)
+        return kinetic + pair_potential;
+    double potential = 0.0;
+    if (integrator == Integrator::WisdomHolman
+        && wisdom_holman.potential_energy(PhysicsConstants::G, EPSILON, potential))
+        return kinetic + potential;
+
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+            double dx = double(pos_x[j]) - pos_x[i];
+            double dy = double(pos_y[j]) - pos_y[i];
+            double dist = std::sqrt(dx * dx + dy * dy);
+            if (dist < EPSILON) continue;
+
+            potential -= PhysicsConstants::G * double(masses[i]) * masses[j] / dist;
+        }
+    }
+    return kinetic + potential;
+}
+
+template <typename T>
+double BasicPhysicsWorld<T>::total_angular_momentum(const std::vector<CelestialBody>& bodies)
+{
+    sync(bodies);
+
+    // About the centre of mass, so a drifting system keeps a fixed value
+    const size_t n = pos_x.size();
+    double mass = 0.0, cx = 0.0, cy = 0.0, cvx = 0.0, cvy = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double m = masses[i];
+        mass += m;
+        cx += m * pos_x[i];
+        cy += m * pos_y[i];
+        cvx += m * vel_x[i];
+        cvy += m * vel_y[i];
+    }
+    if (mass <= 0.0) return 0.0;
+    cx /= mass; cy /= mass; cvx /= mass; cvy /= mass;
+
+    double momentum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        double rx = pos_x[i] - cx, ry = pos_y[i] - cy;
+        double vx = vel_x[i] - cvx, vy = vel_y[i] - cvy;
+        momentum += double(masses[i]) * (rx * vy - ry * vx);
+    }
+    return momentum;
+}
+
+template class BasicPhysicsWorld<float>;
+template class BasicPhysicsWorld<double>;
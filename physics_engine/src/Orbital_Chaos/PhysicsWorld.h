@@ -1,13 +1,211 @@
 #pragma once
 #include <SFML/Graphics.hpp>
+#include <vector>
 #include "CelestialBody.h"
+#include "BarnesHut.h"
+#include "ParticleMesh.h"
+#include "BlockTimesteps.h"
+#include "WisdomHolman.h"
+#include "TestParticles.h"
+#include "SpatialHash.h"
+#include "Regularization.h"
+
+class ThreadPool;
 
 namespace PhysicsConstants {
     constexpr float G = 1.0f;
 }
 
-class PhysicsWorld
+enum class GravitySolver {
+    Direct,         // O(N^2) pairwise sum, the accuracy reference
+    BarnesHut,      // O(N log N) quadtree
+    ParticleMesh    // O(N + M log M) FFT mesh of M nodes, smoothed below ~2 cells
+};
+
+// Symplectic splitting integrators as sequences of drifts (x += c dt v)
+// and kicks (v += d dt a):
+//  VelocityVerlet  2nd order, 1 force evaluation per step
+//  ForestRuth      4th order, 3 (drift-first triple jump)
+//  PEFRL           4th order, 4 (Omelyan et al., much smaller error constant)
+//  Yoshida4        4th order, 3 (kick-first triple jump)
+//  Yoshida6        6th order, 7 (Yoshida's solution A)
+//  WisdomHolman    Kepler drifts around the heaviest body + planet kicks,
+//                  1 planet-planet evaluation per step
+// and, not a splitting scheme:
+//  HermiteBlock    4th-order Hermite with individual block timesteps
+//                  (direct forces; dt is the largest block step)
+enum class Integrator {
+    VelocityVerlet,
+    ForestRuth,
+    PEFRL,
+    Yoshida4,
+    Yoshida6,
+    WisdomHolman,
+    HermiteBlock
+};
+
+const char* integrator_name(Integrator integrator);
+// Order of the global error in dt
+int integrator_order(Integrator integrator);
+
+// Integration runs on persistent structure-of-arrays state. Accelerations
+// stay cached while positions do not move, so a kick-first scheme reuses the
+// last kick of the previous step, and the buffers are only reallocated when
+// the number of bodies grows.
+//
+// Force evaluation is split into tasks whose boundaries depend only on the
+// number of bodies. Pair-symmetric tasks accumulate into their own buffers,
+// which are summed in task order, so results are bitwise identical for any
+// thread count (including none).
+//
+// T is the scalar type of the physics state and all accumulation; bodies keep
+// float positions for rendering, and as long as they still hold the rounded
+// state the full-precision state carries on between calls. float uses the
+// SIMD direct kernels; double is for long integrations (pair-symmetric loop,
+// Barnes-Hut through a float copy). Drifts can also be Kahan-compensated.
+template <typename T>
+class BasicPhysicsWorld
 {
 public:
-    void update_physics(std::vector<CelestialBody>& bodies, float dt);
-};
\ No newline at end of file
+    using Scalar = T;
+
+    void update_physics(std::vector<CelestialBody>& bodies, T dt);
+
+    void set_integrator(Integrator i) { integrator = i; block.reset(); wisdom_holman.reset(); }
+    Integrator get_integrator() const { return integrator; }
+
+    void set_gravity_solver(GravitySolver s) { solver = s; invalidate(); }
+    GravitySolver get_gravity_solver() const { return solver; }
+
+    // Barnes-Hut opening angle: smaller is more accurate, 0 opens every node
+    void set_opening_angle(float theta) { tree.set_opening_angle(theta); invalidate(); }
+    float get_opening_angle() const { return tree.get_opening_angle(); }
+
+    // Particle-mesh nodes per side (power of two)
+    void set_mesh_size(size_t nodes) { mesh.set_mesh_size(nodes); invalidate(); }
+    size_t get_mesh_size() const { return mesh.get_mesh_size(); }
+
+    // nullptr = evaluate forces on the calling thread
+    void set_thread_pool(ThreadPool* p) { pool = p; block.set_thread_pool(p); mesh.set_thread_pool(p); test_particles.set_thread_pool(p); }
+
+    // Kahan-compensated position updates in the splitting drifts
+    void set_compensated_drift(bool enabled) { compensated = enabled; }
+    bool get_compensated_drift() const { return compensated; }
+
+    // Aarseth accuracy parameter of the block timesteps
+    void set_block_accuracy(float eta) { block.set_accuracy(eta); }
+
+    // Merge bodies whose discs (CelestialBody radius) overlap after a step.
+    // Mass, momentum and volume (r^3) are conserved; the merged body keeps the
+    // index and color of the heaviest one and the others are erased from the
+    // vector passed to update_physics.
+    void set_collisions(bool enabled) { collisions = enabled; }
+    bool get_collisions() const { return collisions; }
+
+    // Indices (before erasing) of the bodies absorbed by the last update_physics call
+    const std::vector<size_t>& get_removed_bodies() const { return removed_bodies; }
+
+    // Splitting integrators: move close pairs with a regularized two-body
+    // step instead of resolving their orbit with the global step
+    void set_regularization(bool enabled) { regularization = enabled; }
+    bool get_regularization() const { return regularization; }
+    // Pairs with fewer than this many steps per two-body dynamical time
+    void set_regularization_threshold(float steps) { close_encounters.set_steps_per_dynamical_time(steps); }
+    // Regularized pairs of the last step
+    size_t get_regularized_pairs() const { return close_encounters.pair_count(); }
+
+    // Massless particles moved along by update_physics (attracted by the bodies only)
+    TestParticles<T>& get_test_particles() { return test_particles; }
+    const TestParticles<T>& get_test_particles() const { return test_particles; }
+
+    // Forget the cached accelerations (bodies are also re-checked every call)
+    void invalidate() { accel_valid = false; }
+
+    // Force evaluations so far (for cost comparisons)
+    unsigned long long get_force_evaluations() const { return force_evaluations; }
+    // Single-body force evaluations (partial updates of block timesteps count per body)
+    unsigned long long get_body_evaluations() const {
+        return body_evaluations + block.get_body_evaluations() + wisdom_holman.get_body_evaluations();
+    }
+
+    // Full-precision phase space, (x, y, vx, vy) per body. set_state also
+    // rounds it into the bodies and restarts the integrators from it.
+    void get_state(const std::vector<CelestialBody>& bodies, std::vector<T>& state);
+    void set_state(std::vector<CelestialBody>& bodies, const std::vector<T>& state);
+
+    // Kinetic + potential energy, in double precision (direct sum, or the
+    // pair terms of the last force evaluation or Wisdom-Holman kick if the
+    // bodies have not moved since)
+    double total_energy(const std::vector<CelestialBody>& bodies);
+    // About the centre of mass, in double precision
+    double total_angular_momentum(const std::vector<CelestialBody>& bodies);
+
+    // RMS relative acceleration error of the active solver against direct summation
+    float measure_force_error(const std::vector<CelestialBody>& bodies);
+
+private:
+    Integrator integrator = Integrator::VelocityVerlet;
+    GravitySolver solver = GravitySolver::Direct;
+    BarnesHutTree tree;
+    ParticleMesh mesh;
+
+    // Persistent state
+    std::vector<T> pos_x, pos_y;
+    std::vector<T> vel_x, vel_y;
+    std::vector<T> masses;
+    std::vector<T> acc_x, acc_y;
+    bool accel_valid = false;
+
+    // Running compensation of the position sums
+    std::vector<T> comp_x, comp_y;
+    bool compensated = false;
+    unsigned long long force_evaluations = 0;
+    unsigned long long body_evaluations = 0;
+
+    BlockTimestepIntegrator<T> block;
+    WisdomHolmanIntegrator wisdom_holman;
+    TestParticles<T> test_particles;
+
+    ThreadPool* pool = nullptr;
+
+    // Close-pair regularization
+    bool regularization = false;
+    CloseEncounters close_encounters;
+
+    // Collisions
+    bool collisions = false;
+    SpatialHash spatial_hash;
+    std::vector<float> radii;
+    std::vector<SpatialHash::Pair> overlaps;
+    std::vector<uint32_t> merge_group, merge_members;
+    std::vector<bool> merge_removed;
+    std::vector<size_t> removed_bodies;
+
+    // Per-task accumulators of the pair-symmetric loop
+    std::vector<size_t> pair_task_rows;
+    std::vector<T> pair_acc_x, pair_acc_y;
+    std::vector<double> pair_task_potential;
+    double pair_potential = 0.0;
+    bool pair_potential_valid = false;   // for the positions of the cached accelerations
+
+    // float copies for the tree and the mesh when T is double
+    std::vector<float> single_x, single_y, single_mass, single_ax, single_ay;
+
+    void sync(const std::vector<CelestialBody>& bodies);
+    bool gather(const std::vector<CelestialBody>& bodies);
+    void splitting_step(T dt);
+    void kick_test_particles(T h);
+    void merge_collisions(std::vector<CelestialBody>& bodies);
+    void compute_accelerations(GravitySolver method, T* ax, T* ay);
+    void approximate_accelerations(GravitySolver method, T* ax, T* ay);
+    void pair_accelerations(T* ax, T* ay);
+    void pair_rows(size_t row_begin, size_t row_end, T* ax, T* ay, double& potential) const;
+    template <typename Job>
+    void run_tasks(size_t count, const Job& job);
+};
+
+extern template class BasicPhysicsWorld<float>;
+extern template class BasicPhysicsWorld<double>;
+
+using PhysicsWorld = BasicPhysicsWorld<float>;
+using PhysicsWorldDouble = BasicPhysicsWorld<double>;
@@ -0,0 +1,316 @@
+#include "PotentialField.h"
+#include "../Common/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Color range from these quantiles of log10 |field| (the wells near the
+    // bodies would otherwise take most of it)
+    const float LOW_QUANTILE = 0.01f;
+    const float HIGH_QUANTILE = 0.995f;
+
+    // Inferno-like ramp, dark to bright
+    const float RAMP[5][3] = {
+        { 0.f, 0.f, 4.f },
+        { 87.f, 16.f, 110.f },
+        { 188.f, 55.f, 84.f },
+        { 249.f, 142.f, 9.f },
+        { 252.f, 255.f, 164.f }
+    };
+}
+
+PotentialField::PotentialField()
+{
+    layout();
+}
+
+// -------------Settings----------------
+void PotentialField::set_region(const sf::FloatRect& rect, sf::Vector2u count)
+{
+    count.x = std::max(count.x, 1u);
+    count.y = std::max(count.y, 1u);
+    if (rect == area && count == samples) return;
+
+    area = rect;
+    samples = count;
+    layout();
+}
+
+void PotentialField::set_quantity(FieldQuantity q)
+{
+    if (q == quantity) return;
+    quantity = q;
+    invalidate();
+}
+
+void PotentialField::set_gravity_solver(GravitySolver s)
+{
+    if (s == solver) return;
+    solver = s;
+    invalidate();
+}
+
+void PotentialField::invalidate()
+{
+    for (Tile& tile : tiles)
+        tile.stale = true;
+    range_valid = false;
+}
+
+void PotentialField::layout()
+{
+    spacing = { area.size.x / samples.x, area.size.y / samples.y };
+    tiles_x = (samples.x + TILE - 1) / TILE;
+    tiles_y = (samples.y + TILE - 1) / TILE;
+
+    tiles.assign(static_cast<size_t>(tiles_x) * tiles_y, Tile{});
+    for (unsigned int ty = 0; ty < tiles_y; ty++) {
+        for (unsigned int tx = 0; tx < tiles_x; tx++) {
+            Tile& tile = tiles[ty * tiles_x + tx];
+            tile.x0 = tx * TILE;
+            tile.y0 = ty * TILE;
+            tile.x1 = std::min(samples.x, tile.x0 + TILE);
+            tile.y1 = std::min(samples.y, tile.y0 + TILE);
+        }
+    }
+
+    const size_t count = static_cast<size_t>(samples.x) * samples.y;
+    values.assign(count, 0.f);
+    pixels.assign(4 * count, 0);
+    tile_pixels.resize(4 * TILE * TILE);
+    texture_ready = false;
+    range_valid = false;
+}
+
+// -------------Update----------------
+void PotentialField::update(const std::vector<CelestialBody>& bodies)
+{
+    src_x.clear();
+    src_y.clear();
+    src_mass.clear();
+    for (const CelestialBody& body : bodies) {
+        if (body.get_mass() <= 0.f) continue;
+        src_x.push_back(body.get_position().x);
+        src_y.push_back(body.get_position().y);
+        src_mass.push_back(body.get_mass());
+    }
+
+    // Added, removed or merged bodies change the field everywhere
+    if (src_mass != last_mass)
+        invalidate();
+    else
+        accumulate_errors();
+    last_x = src_x;
+    last_y = src_y;
+    last_mass = src_mass;
+
+    std::vector<size_t> due;
+    for (size_t t = 0; t < tiles.size(); t++)
+        if (tiles[t].stale || tiles[t].error > tolerance) due.push_back(t);
+    updated_tiles = due.size();
+    if (due.empty() && !recolor_all) return;
+
+    if (!due.empty() && !src_mass.empty()) {
+        if (solver == GravitySolver::BarnesHut) {
+            tree.build(src_x.data(), src_y.data(), src_mass.data(), src_mass.size());
+        }
+        else if (solver == GravitySolver::ParticleMesh) {
+            mesh.set_potential(quantity == FieldQuantity::Potential);
+            mesh.build(src_x.data(), src_y.data(), src_mass.data(), src_mass.size(),
+                area.position.x, area.position.y, area.position.x + area.size.x, area.position.y + area.size.y);
+        }
+    }
+
+    run_tasks(due.size(), [&](size_t k) { evaluate(tiles[due[k]]); });
+
+    if (!range_valid) {
+        fit_range();
+        recolor_all = true;
+    }
+    if (recolor_all) {
+        run_tasks(tiles.size(), [&](size_t t) { color(tiles[t]); });
+        for (Tile& tile : tiles) tile.upload = true;
+        recolor_all = false;
+    }
+    else {
+        run_tasks(due.size(), [&](size_t k) { color(tiles[due[k]]); });
+        for (size_t t : due) tiles[t].upload = true;
+    }
+}
+
+// Bound of the change since the last update, from every body that moved
+void PotentialField::accumulate_errors()
+{
+    struct Move { float x, y, distance, gm; };
+    std::vector<Move> moves;
+    for (size_t i = 0; i < src_x.size(); i++) {
+        float dx = src_x[i] - last_x[i], dy = src_y[i] - last_y[i];
+        float distance = std::sqrt(dx * dx + dy * dy);
+        if (distance > 0.f)
+            moves.push_back({ src_x[i], src_y[i], distance, PhysicsConstants::G * src_mass[i] });
+    }
+    if (moves.empty()) return;
+
+    const float softening = std::max(spacing.x, spacing.y);
+    const bool potential = quantity == FieldQuantity::Potential;
+
+    run_tasks(tiles.size(), [&](size_t t) {
+        Tile& tile = tiles[t];
+        if (tile.stale) return;
+        if (!(tile.scale > 0.f)) {
+            tile.stale = true;
+            return;
+        }
+
+        const float left = area.position.x + tile.x0 * spacing.x;
+        const float top = area.position.y + tile.y0 * spacing.y;
+        const float right = area.position.x + tile.x1 * spacing.x;
+        const float bottom = area.position.y + tile.y1 * spacing.y;
+
+        float bound = 0.f;
+        for (const Move& move : moves) {
+            // Closest the body came to the tile during the move
+            float dx = std::max({ left - move.x, 0.f, move.x - right });
+            float dy = std::max({ top - move.y, 0.f, move.y - bottom });
+            float r = std::max(std::sqrt(dx * dx + dy * dy) - move.distance, softening);
+            bound += potential ? move.gm * move.distance / (r * r) : 2.f * move.gm * move.distance / (r * r * r);
+        }
+        tile.error += bound / tile.scale;
+    });
+}
+
+void PotentialField::evaluate(Tile& tile)
+{
+    const float softening = std::max(spacing.x, spacing.y);
+    const float softening2 = softening * softening;
+    const float G = PhysicsConstants::G;
+    const size_t n = src_mass.size();
+
+    float scale = INFINITY;
+    for (unsigned int sy = tile.y0; sy < tile.y1; sy++) {
+        for (unsigned int sx = tile.x0; sx < tile.x1; sx++) {
+            const sf::Vector2f p = sample_position(sx, sy);
+            float phi = 0.f, ax = 0.f, ay = 0.f;
+
+            if (n == 0) {
+                // Empty: nothing to draw
+            }
+            else if (solver == GravitySolver::BarnesHut) {
+                tree.sample(p.x, p.y, G, softening, phi, ax, ay);
+            }
+            else if (solver == GravitySolver::ParticleMesh) {
+                mesh.sample(p.x, p.y, G, phi, ax, ay);
+            }
+            else {
+                for (size_t j = 0; j < n; j++) {
+                    float dx = src_x[j] - p.x, dy = src_y[j] - p.y;
+                    float inv_dist = 1.f / std::sqrt(dx * dx + dy * dy + softening2);
+                    float gm = G * src_mass[j] * inv_dist;
+                    phi -= gm;
+                    ax += dx * gm * inv_dist * inv_dist;
+                    ay += dy * gm * inv_dist * inv_dist;
+                }
+            }
+
+            float value = quantity == FieldQuantity::Potential ? std::abs(phi) : std::sqrt(ax * ax + ay * ay);
+            values[static_cast<size_t>(sy) * samples.x + sx] = value;
+            scale = std::min(scale, value);
+        }
+    }
+
+    tile.scale = scale;
+    tile.error = 0.f;
+    tile.stale = false;
+}
+
+// Color range of the current values; kept until invalidated so that updating
+// some tiles never changes the colors of the others
+void PotentialField::fit_range()
+{
+    std::vector<float> logs;
+    logs.reserve(values.size());
+    for (float value : values)
+        if (value > 0.f) logs.push_back(std::log10(value));
+    if (logs.empty()) return;
+
+    auto quantile = [&](float q) {
+        auto it = logs.begin() + static_cast<std::ptrdiff_t>(q * (logs.size() - 1));
+        std::nth_element(logs.begin(), it, logs.end());
+        return *it;
+    };
+    log_low = quantile(LOW_QUANTILE);
+    log_high = std::max(quantile(HIGH_QUANTILE), log_low + 1e-3f);
+    range_valid = true;
+}
+
+void PotentialField::color(const Tile& tile)
+{
+    const float inv_range = 1.f / (log_high - log_low);
+
+    for (unsigned int sy = tile.y0; sy < tile.y1; sy++) {
+        for (unsigned int sx = tile.x0; sx < tile.x1; sx++) {
+            const size_t i = static_cast<size_t>(sy) * samples.x + sx;
+            std::uint8_t* pixel = pixels.data() + 4 * i;
+
+            if (!(values[i] > 0.f)) {
+                pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
+                continue;
+            }
+
+            float t = std::clamp((std::log10(values[i]) - log_low) * inv_range, 0.f, 1.f);
+            float f = t * 4.f;
+            int k = std::min(static_cast<int>(f), 3);
+            f -= static_cast<float>(k);
+            for (int c = 0; c < 3; c++)
+                pixel[c] = static_cast<std::uint8_t>(RAMP[k][c] + f * (RAMP[k + 1][c] - RAMP[k][c]));
+            // Weak field fades into the background
+            pixel[3] = static_cast<std::uint8_t>(opacity * (0.2f + 0.8f * t));
+        }
+    }
+}
+
+sf::Vector2f PotentialField::sample_position(unsigned int sx, unsigned int sy) const
+{
+    return { area.position.x + (sx + 0.5f) * spacing.x, area.position.y + (sy + 0.5f) * spacing.y };
+}
+
+// -------------Drawing----------------
+void PotentialField::draw(sf::RenderTarget& target)
+{
+    if (!texture_ready) {
+        if (!texture.resize(samples)) return;
+        texture.setSmooth(true);
+        texture_ready = true;
+        for (Tile& tile : tiles) tile.upload = true;
+    }
+
+    // Only the tiles that changed
+    for (Tile& tile : tiles) {
+        if (!tile.upload) continue;
+        tile.upload = false;
+
+        const unsigned int width = tile.x1 - tile.x0;
+        for (unsigned int sy = tile.y0; sy < tile.y1; sy++) {
+            const std::uint8_t* row = pixels.data() + 4 * (static_cast<size_t>(sy) * samples.x + tile.x0);
+            std::copy(row, row + 4 * width, tile_pixels.data() + 4 * (sy - tile.y0) * width);
+        }
+        texture.update(tile_pixels.data(), { width, tile.y1 - tile.y0 }, { tile.x0, tile.y0 });
+    }
+
+    sf::Sprite sprite(texture);
+    sprite.setPosition(area.position);
+    sprite.setScale(spacing);
+    target.draw(sprite);
+}
+
+template <typename Job>
+void PotentialField::run_tasks(size_t count, const Job& job)
+{
+    if (pool && count > 1) {
+        pool->parallelTasks(count, [&](size_t task, unsigned int) { job(task); });
+        return;
+    }
+
+    for (size_t task = 0; task < count; task++)
+        job(task);
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <vector>
+#include "CelestialBody.h"
+#include "PhysicsWorld.h"
+
+class ThreadPool;
+
+enum class FieldQuantity {
+    Potential,      // |phi|
+    Acceleration    // |a|
+};
+
+// Heatmap overlay of the gravitational field of the bodies over a region.
+// The field is sampled on a grid (a few pixels apart, drawn with bilinear
+// smoothing) split into square tiles, and evaluated with the same solver as
+// the physics world: direct sums, the Barnes-Hut tree or the particle mesh
+// (solved over the region as well as the bodies), Plummer-softened by the
+// sample spacing. Tiles are evaluated in parallel on the thread pool.
+//
+// Updates are incremental. Moving a body of mass m by d changes the
+// potential at distance r by at most G m d / r^2 (the acceleration by
+// 2 G m d / r^3), so every tile accumulates that bound for the body moves
+// since it was evaluated, relative to its weakest sample, and is only
+// re-evaluated (and re-uploaded) once it exceeds the tolerance. Far from
+// moving bodies tiles stay untouched for many frames.
+class PotentialField
+{
+public:
+    PotentialField();
+
+    // World rectangle covered, and samples per side; changing either
+    // re-evaluates everything
+    void set_region(const sf::FloatRect& area, sf::Vector2u samples);
+    void set_quantity(FieldQuantity q);
+    FieldQuantity get_quantity() const { return quantity; }
+
+    // Solver settings, as in the physics world
+    void set_gravity_solver(GravitySolver s);
+    void set_opening_angle(float theta) { tree.set_opening_angle(theta); invalidate(); }
+    void set_mesh_size(size_t nodes) { mesh.set_mesh_size(nodes); invalidate(); }
+
+    // nullptr = evaluate on the calling thread
+    void set_thread_pool(ThreadPool* p) { pool = p; mesh.set_thread_pool(p); }
+
+    // Largest relative change a tile may miss before it is re-evaluated
+    void set_tolerance(float relative) { tolerance = relative; }
+    // Alpha of the strongest field
+    void set_opacity(std::uint8_t alpha) { opacity = alpha; recolor_all = true; }
+
+    // Re-evaluate every tile (and the color range) on the next update
+    void invalidate();
+
+    // Once per frame with the current bodies
+    void update(const std::vector<CelestialBody>& bodies);
+    void draw(sf::RenderTarget& target);
+
+    size_t get_tile_count() const { return tiles.size(); }
+    // Tiles evaluated by the last update
+    size_t get_updated_tiles() const { return updated_tiles; }
+
+private:
+    static const unsigned int TILE = 32;   // samples per tile side
+
+    struct Tile {
+        unsigned int x0, y0, x1, y1;    // sample range
+        float scale = 0.f;              // weakest field in the tile
+        float error = 0.f;              // relative change bound since evaluated
+        bool stale = true;
+        bool upload = false;
+    };
+
+    sf::FloatRect area{ { 0.f, 0.f }, { 1.f, 1.f } };
+    sf::Vector2u samples{ 1, 1 };
+    sf::Vector2f spacing{ 1.f, 1.f };
+    unsigned int tiles_x = 0, tiles_y = 0;
+    std::vector<Tile> tiles;
+
+    FieldQuantity quantity = FieldQuantity::Potential;
+    GravitySolver solver = GravitySolver::Direct;
+    BarnesHutTree tree;
+    ParticleMesh mesh;
+    ThreadPool* pool = nullptr;
+    float tolerance = 0.01f;
+    std::uint8_t opacity = 110;
+
+    // Sources (massive bodies), now and at the previous update
+    std::vector<float> src_x, src_y, src_mass;
+    std::vector<float> last_x, last_y, last_mass;
+
+    std::vector<float> values;          // field magnitude per sample
+    std::vector<std::uint8_t> pixels;   // RGBA per sample
+    std::vector<std::uint8_t> tile_pixels;
+    float log_low = 0.f, log_high = 1.f;
+    bool range_valid = false;
+    bool recolor_all = true;
+    size_t updated_tiles = 0;
+
+    sf::Texture texture;
+    bool texture_ready = false;
+
+    void layout();
+    void accumulate_errors();
+    void evaluate(Tile& tile);
+    void fit_range();
+    void color(const Tile& tile);
+    sf::Vector2f sample_position(unsigned int sx, unsigned int sy) const;
+
+    template <typename Job>
+    void run_tasks(size_t count, const Job& job);
+};
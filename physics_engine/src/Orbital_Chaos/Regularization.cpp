@@ -0,0 +1,227 @@
+#include "Regularization.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+namespace {
+    using Complex = std::complex<double>;
+
+    // c = cos(w s), S = sin(w s) / w with w^2 = beta (cosh / sinh for beta < 0),
+    // and I = integral of S^2 over [0, s] = (s - S c) / (2 beta)
+    void oscillator(double beta, double s, double& c, double& S, double& I)
+    {
+        if (beta > 0.0) {
+            double w = std::sqrt(beta);
+            c = std::cos(w * s);
+            S = std::sin(w * s) / w;
+        }
+        else if (beta < 0.0) {
+            double w = std::sqrt(-beta);
+            c = std::cosh(w * s);
+            S = std::sinh(w * s) / w;
+        }
+        else {
+            c = 1.0;
+            S = s;
+        }
+
+        // Series near beta s^2 = 0, where the closed form cancels
+        const double x = beta * s * s;
+        if (std::abs(x) < 0.1) {
+            double term = s * s * s / 3.0;
+            I = term;
+            for (int k = 1; k < 20 && std::abs(term) > 1e-17 * std::abs(I); k++) {
+                term *= -4.0 * x / ((2.0 * k + 2.0) * (2.0 * k + 3.0));
+                I += term;
+            }
+        }
+        else {
+            I = (s - S * c) / (2.0 * beta);
+        }
+    }
+}
+
+// -------------Two-body step----------------
+bool CloseEncounters::two_body_step(double& x, double& y, double& vx, double& vy, double mu, double dt)
+{
+    if (dt == 0.0) return true;
+
+    const Complex z0(x, y), v0(vx, vy);
+    const double r0 = std::abs(z0);
+    if (r0 == 0.0 || mu <= 0.0) return false;
+
+    // z = u^2, and with dt = r ds: u' = conj(u) v / 2, u'' = (E / 2) u
+    const Complex u0 = std::sqrt(z0);
+    const Complex du0 = std::conj(u0) * v0 * 0.5;
+    const double energy = 0.5 * std::norm(v0) - mu / r0;
+    const double beta = -0.5 * energy;
+
+    // u(s) = u0 c + u0' S, so t(s) = integral of |u|^2 over [0, s]
+    //      = A (s + S c) / 2 + B I + C S^2
+    const double A = std::norm(u0);
+    const double B = std::norm(du0);
+    const double C = std::real(u0 * std::conj(du0));
+
+    double c, S, I;
+    auto time_at = [&](double s) {
+        oscillator(beta, s, c, S, I);
+        return 0.5 * A * (s + S * c) + B * I + C * S * S;
+    };
+
+    // t(s) is increasing (t' = r): bracket the root from the first-order
+    // guess dt / r0, then safeguarded Newton
+    const bool forward = dt > 0.0;
+    double lo = 0.0, hi = 0.0;
+    double s = dt / r0;
+    for (int i = 0; ; i++) {
+        double t = time_at(s);
+        if (!std::isfinite(t) || i == 200) return false;
+        if (forward ? t >= dt : t <= dt) break;
+        (forward ? lo : hi) = s;
+        s *= 2.0;
+    }
+    (forward ? hi : lo) = s;
+
+    bool converged = false;
+    for (int i = 0; i < 100 && !converged; i++) {
+        double f = time_at(s) - dt;
+        if (f == 0.0) {
+            converged = true;
+            break;
+        }
+        (f < 0.0 ? lo : hi) = s;
+
+        double r = A * c * c + B * S * S + 2.0 * C * c * S;
+        double next = r > 0.0 ? s - f / r : 0.5 * (lo + hi);
+        if (!(next > lo && next < hi))
+            next = 0.5 * (lo + hi);
+
+        converged = std::abs(next - s) <= 1e-14 * std::abs(s);
+        s = next;
+    }
+    if (!converged) return false;
+
+    oscillator(beta, s, c, S, I);
+    const Complex u = u0 * c + du0 * S;
+    const Complex du = -beta * u0 * S + du0 * c;
+    const double r = std::norm(u);
+    if (r == 0.0) return false;
+
+    const Complex z = u * u;
+    const Complex v = 2.0 * u * du / r;
+    x = z.real(); y = z.imag();
+    vx = v.real(); vy = v.imag();
+    return true;
+}
+
+// -------------Pairing----------------
+template <typename T>
+bool CloseEncounters::find_pairs(const T* x, const T* y, const T* mass, size_t count, double dt, double G)
+{
+    previous_pairs.swap(pairs);
+    pairs.clear();
+    partner.assign(count, NONE);
+
+    // r^3 < G (m_i + m_j) window^2 implies r < max(reach_i, reach_j) with
+    // reach = (2 G m window^2)^(1/3), so overlapping reach discs are a superset
+    const double window = steps_per_time * std::abs(dt);
+    reach.resize(count);
+    for (size_t i = 0; i < count; i++)
+        reach[i] = mass[i] > 0 ? static_cast<float>(std::cbrt(2.0 * G * mass[i] * window * window)) : 0.0f;
+
+    hash.find_overlaps(x, y, reach.data(), count, candidates);
+
+    // Tightest pairs first: r^3 / (G M) = dynamical time^2
+    close_pairs.clear();
+    for (const auto& candidate : candidates) {
+        uint32_t i = candidate.first, j = candidate.second;
+        double gm = G * (double(mass[i]) + mass[j]);
+        double dx = double(x[j]) - x[i];
+        double dy = double(y[j]) - y[i];
+        double r2 = dx * dx + dy * dy;
+        double time2 = r2 * std::sqrt(r2) / gm;
+        if (r2 > 0.0 && time2 < window * window)
+            close_pairs.push_back({ time2, candidate });
+    }
+    std::sort(close_pairs.begin(), close_pairs.end());
+
+    for (const auto& entry : close_pairs) {
+        uint32_t i = entry.second.first, j = entry.second.second;
+        if (partner[i] != NONE || partner[j] != NONE) continue;
+
+        partner[i] = j;
+        partner[j] = i;
+        pairs.push_back(entry.second);
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    return pairs != previous_pairs;
+}
+
+// -------------Pair motion----------------
+template <typename T>
+void CloseEncounters::drift(T* x, T* y, T* vx, T* vy, const T* mass, double h, double G) const
+{
+    for (const auto& pair : pairs) {
+        const uint32_t i = pair.first, j = pair.second;
+        const double mi = mass[i], mj = mass[j], m = mi + mj;
+
+        // Centre of mass moves in a straight line
+        double cx = (mi * x[i] + mj * x[j]) / m;
+        double cy = (mi * y[i] + mj * y[j]) / m;
+        double cvx = (mi * vx[i] + mj * vx[j]) / m;
+        double cvy = (mi * vy[i] + mj * vy[j]) / m;
+        cx += cvx * h;
+        cy += cvy * h;
+
+        double rx = double(x[i]) - x[j], ry = double(y[i]) - y[j];
+        double rvx = double(vx[i]) - vx[j], rvy = double(vy[i]) - vy[j];
+        if (!two_body_step(rx, ry, rvx, rvy, G * m, h)) {
+            // Free flight if the solve fails (keeps the state finite)
+            rx += rvx * h;
+            ry += rvy * h;
+        }
+
+        x[i] = static_cast<T>(cx + mj / m * rx);  y[i] = static_cast<T>(cy + mj / m * ry);
+        x[j] = static_cast<T>(cx - mi / m * rx);  y[j] = static_cast<T>(cy - mi / m * ry);
+        vx[i] = static_cast<T>(cvx + mj / m * rvx);  vy[i] = static_cast<T>(cvy + mj / m * rvy);
+        vx[j] = static_cast<T>(cvx - mi / m * rvx);  vy[j] = static_cast<T>(cvy - mi / m * rvy);
+    }
+}
+
+template <typename T>
+void CloseEncounters::external_accelerations(const T* x, const T* y, const T* mass, size_t count,
+    double G, double epsilon, T* ax, T* ay) const
+{
+    for (const auto& pair : pairs) {
+        for (uint32_t i : { pair.first, pair.second }) {
+            const uint32_t other = partner[i];
+            double sum_x = 0.0, sum_y = 0.0;
+
+            for (size_t k = 0; k < count; k++) {
+                if (k == i || k == other) continue;
+
+                double dx = double(x[k]) - x[i];
+                double dy = double(y[k]) - y[i];
+                double dist = std::sqrt(dx * dx + dy * dy);
+                if (dist < epsilon) continue;
+
+                double scale = G * mass[k] / (dist * dist * dist);
+                sum_x += dx * scale;
+                sum_y += dy * scale;
+            }
+
+            ax[i] = static_cast<T>(sum_x);
+            ay[i] = static_cast<T>(sum_y);
+        }
+    }
+}
+
+template bool CloseEncounters::find_pairs<float>(const float*, const float*, const float*, size_t, double, double);
+template bool CloseEncounters::find_pairs<double>(const double*, const double*, const double*, size_t, double, double);
+template void CloseEncounters::drift<float>(float*, float*, float*, float*, const float*, double, double) const;
+template void CloseEncounters::drift<double>(double*, double*, double*, double*, const double*, double, double) const;
+template void CloseEncounters::external_accelerations<float>(const float*, const float*, const float*, size_t,
+    double, double, float*, float*) const;
+template void CloseEncounters::external_accelerations<double>(const double*, const double*, const double*, size_t,
+    double, double, double*, double*) const;
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "SpatialHash.h"
+
+// Levi-Civita regularization of close pairs for the splitting integrators.
+// A pair is close when its two-body dynamical time sqrt(r^3 / G M) is shorter
+// than a few global steps; each body joins at most one pair (the tightest).
+// The splitting then moves a pair apart from the rest (as Wisdom-Holman does
+// with the central body):
+//  - drift: centre of mass in a straight line, relative motion by an exact
+//    two-body step in Levi-Civita coordinates (z = u^2, dt = r ds), where the
+//    Kepler problem is a harmonic oscillator in the fictitious time s and
+//    stays regular through r -> 0
+//  - kick : every force except the mutual one of the pair
+// so the global step no longer has to resolve the pair's orbit.
+class CloseEncounters
+{
+public:
+    // Pair bodies with fewer than this many steps per dynamical time
+    void set_steps_per_dynamical_time(float steps) { steps_per_time = steps; }
+    float get_steps_per_dynamical_time() const { return steps_per_time; }
+
+    // Select the pairs for a step of dt; true if they changed
+    template <typename T>
+    bool find_pairs(const T* x, const T* y, const T* mass, size_t count, double dt, double G);
+    void clear() { pairs.clear(); partner.clear(); }
+
+    const std::vector<SpatialHash::Pair>& get_pairs() const { return pairs; }
+    size_t pair_count() const { return pairs.size(); }
+    bool empty() const { return pairs.empty(); }
+    bool is_paired(size_t i) const { return i < partner.size() && partner[i] != NONE; }
+
+    // Pair members: centre-of-mass drift and regularized relative motion
+    template <typename T>
+    void drift(T* x, T* y, T* vx, T* vy, const T* mass, double h, double G) const;
+
+    // Pair members: accelerations from all bodies except the partner
+    template <typename T>
+    void external_accelerations(const T* x, const T* y, const T* mass, size_t count,
+        double G, double epsilon, T* ax, T* ay) const;
+
+    // Advance relative position and velocity of a two-body problem with
+    // mu = G (m1 + m2) by dt; false (state untouched) if the solve fails
+    static bool two_body_step(double& x, double& y, double& vx, double& vy, double mu, double dt);
+
+private:
+    static constexpr uint32_t NONE = ~0u;
+
+    float steps_per_time = 10.f;
+
+    std::vector<SpatialHash::Pair> pairs;
+    std::vector<uint32_t> partner;
+
+    // Pairing scratch: last pairs, and close candidates by dynamical time
+    SpatialHash hash;
+    std::vector<float> reach;
+    std::vector<SpatialHash::Pair> candidates;
+    std::vector<SpatialHash::Pair> previous_pairs;
+    std::vector<std::pair<double, SpatialHash::Pair>> close_pairs;
+};
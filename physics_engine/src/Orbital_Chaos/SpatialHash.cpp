@@ -0,0 +1,90 @@
+#include "SpatialHash.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Keeps cell coordinates of far-flung bodies representable
+    const double MAX_CELL = 1e12;
+}
+
+uint32_t SpatialHash::hash(int64_t cx, int64_t cy, uint32_t mask)
+{
+    // Teschner et al. (2003) primes
+    uint64_t h = static_cast<uint64_t>(cx) * 73856093u ^ static_cast<uint64_t>(cy) * 19349663u;
+    return static_cast<uint32_t>(h ^ (h >> 32)) & mask;
+}
+
+template <typename T>
+void SpatialHash::find_overlaps(const T* x, const T* y, const float* radius, size_t count, std::vector<Pair>& pairs)
+{
+    pairs.clear();
+
+    float max_radius = 0.0f;
+    for (size_t i = 0; i < count; i++)
+        max_radius = std::max(max_radius, radius[i]);
+    if (count < 2 || max_radius <= 0.0f) return;
+
+    const double cell = 2.0 * max_radius;
+    uint32_t buckets = 1;
+    while (buckets < 2 * count) buckets <<= 1;
+    const uint32_t mask = buckets - 1;
+    const uint32_t NONE = ~0u;
+
+    // Counting sort of the bodies by bucket
+    cell_x.resize(count);
+    cell_y.resize(count);
+    body_bucket.resize(count);
+    bucket_start.assign(buckets + 1, 0);
+
+    for (size_t i = 0; i < count; i++) {
+        body_bucket[i] = NONE;
+        if (radius[i] <= 0.0f || !std::isfinite(double(x[i])) || !std::isfinite(double(y[i]))) continue;
+
+        cell_x[i] = static_cast<int64_t>(std::floor(std::clamp(double(x[i]) / cell, -MAX_CELL, MAX_CELL)));
+        cell_y[i] = static_cast<int64_t>(std::floor(std::clamp(double(y[i]) / cell, -MAX_CELL, MAX_CELL)));
+        body_bucket[i] = hash(cell_x[i], cell_y[i], mask);
+        bucket_start[body_bucket[i] + 1]++;
+    }
+    for (uint32_t b = 0; b < buckets; b++)
+        bucket_start[b + 1] += bucket_start[b];
+
+    bucket_bodies.resize(bucket_start[buckets]);
+    bucket_cursor.assign(bucket_start.begin(), bucket_start.end() - 1);
+    for (size_t i = 0; i < count; i++) {
+        if (body_bucket[i] != NONE)
+            bucket_bodies[bucket_cursor[body_bucket[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    // Each body against the later bodies of the 3x3 neighbouring cells; cells
+    // hashing to the same bucket are visited once
+    for (size_t i = 0; i < count; i++) {
+        if (body_bucket[i] == NONE) continue;
+
+        uint32_t visited[9];
+        int visited_count = 0;
+
+        for (int oy = -1; oy <= 1; oy++) {
+            for (int ox = -1; ox <= 1; ox++) {
+                uint32_t b = hash(cell_x[i] + ox, cell_y[i] + oy, mask);
+                if (std::find(visited, visited + visited_count, b) != visited + visited_count) continue;
+                visited[visited_count++] = b;
+
+                for (uint32_t k = bucket_start[b]; k < bucket_start[b + 1]; k++) {
+                    uint32_t j = bucket_bodies[k];
+                    if (j <= i) continue;
+
+                    double dx = double(x[j]) - x[i];
+                    double dy = double(y[j]) - y[i];
+                    double reach = double(radius[i]) + radius[j];
+                    if (dx * dx + dy * dy < reach * reach)
+                        pairs.push_back({ static_cast<uint32_t>(i), j });
+                }
+            }
+        }
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+}
+
+template void SpatialHash::find_overlaps<float>(const float*, const float*, const float*, size_t, std::vector<Pair>&);
+template void SpatialHash::find_overlaps<double>(const double*, const double*, const float*, size_t, std::vector<Pair>&);
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Overlapping pairs of discs in the unbounded plane.
+// Discs are binned on a uniform grid of cells twice the largest radius, so an
+// overlapping pair always sits in the same or adjacent cells. Cell coordinates
+// are hashed into a power-of-two bucket table (counting sort, as the Atomic
+// cell lists), so empty space costs nothing. Discs of radius 0 never overlap.
+class SpatialHash
+{
+public:
+    using Pair = std::pair<uint32_t, uint32_t>;
+
+    // Pairs (i < j) with |p_i - p_j| < r_i + r_j, sorted
+    template <typename T>
+    void find_overlaps(const T* x, const T* y, const float* radius, size_t count, std::vector<Pair>& pairs);
+
+private:
+    std::vector<uint32_t> bucket_start;     // buckets + 1 entries
+    std::vector<uint32_t> bucket_cursor;    // next free slot per bucket
+    std::vector<uint32_t> bucket_bodies;
+    std::vector<uint32_t> body_bucket;
+    std::vector<int64_t> cell_x, cell_y;
+
+    static uint32_t hash(int64_t cx, int64_t cy, uint32_t mask);
+};
@@ -0,0 +1,46 @@
+#include "SubstepController.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Aim a little below the tolerance, and do not trust a single quiet frame
+    // too much (the energy error of a symplectic step oscillates)
+    const double SAFETY = 0.8;
+    const double MAX_GROWTH = 2.0;
+    const double MAX_SHRINK = 0.1;
+}
+
+void SubstepController::set_substep_range(unsigned int min_count, unsigned int max_count)
+{
+    min_substeps = std::max(min_count, 1u);
+    max_substeps = std::max(max_count, min_substeps);
+}
+
+unsigned int SubstepController::substeps(double frame_time) const
+{
+    if (step <= 0.0 || frame_time <= 0.0) return min_substeps;
+
+    double count = std::ceil(frame_time / step);
+    return static_cast<unsigned int>(std::clamp(count, double(min_substeps), double(max_substeps)));
+}
+
+void SubstepController::update(double energy, double angular_momentum, double frame_time, unsigned int substeps)
+{
+    if (has_reference && frame_time > 0.0 && substeps > 0) {
+        // Relative changes; a zero reference (e.g. no net rotation) is skipped
+        error = 0.0;
+        if (reference_energy != 0.0)
+            error = std::max(error, std::abs((energy - reference_energy) / reference_energy));
+        if (reference_momentum != 0.0)
+            error = std::max(error, std::abs((angular_momentum - reference_momentum) / reference_momentum));
+
+        const double used = frame_time / substeps;
+        double factor = error > 0.0 ? SAFETY * std::pow(tolerance / error, 1.0 / order) : MAX_GROWTH;
+        factor = std::clamp(factor, MAX_SHRINK, MAX_GROWTH);
+        step = used * factor;
+    }
+
+    has_reference = true;
+    reference_energy = energy;
+    reference_momentum = angular_momentum;
+}
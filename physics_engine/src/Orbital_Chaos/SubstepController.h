@@ -0,0 +1,53 @@
+#pragma once
+
+// Picks the number of physics substeps per frame from how well the last
+// frames conserved energy and angular momentum.
+// The larger relative change of the two over a frame is taken as the error
+// of its substep h. With an integrator of order p the error goes as h^p, so
+// the substep that would just have met the tolerance is about
+//   h (tolerance / error)^(1/p)
+// and the next frame is cut into as few substeps of at most that length as
+// possible. Quiet frames end up with a few long substeps, close approaches
+// get many short ones.
+//
+// The tolerance has to sit well above round-off (per-frame changes up to
+// about 1e-7 for float state), or the controller chases the noise.
+class SubstepController
+{
+public:
+    // Relative energy / angular-momentum change allowed per frame
+    void set_tolerance(double relative) { tolerance = relative; }
+    double get_tolerance() const { return tolerance; }
+
+    // Error order of the integrator (see integrator_order)
+    void set_order(int p) { order = p > 0 ? p : 1; }
+
+    void set_substep_range(unsigned int min_count, unsigned int max_count);
+
+    // Substeps for a frame of this length
+    unsigned int substeps(double frame_time) const;
+
+    // Conserved quantities at the end of a frame of frame_time split into
+    // substeps; the first call after a reset only records them
+    void update(double energy, double angular_momentum, double frame_time, unsigned int substeps);
+
+    // Forget the reference values (e.g. after merges, which dissipate energy)
+    void reset() { has_reference = false; }
+
+    // Error estimate of the last frame and the substep length it led to
+    double get_error() const { return error; }
+    double get_step() const { return step; }
+
+private:
+    double tolerance = 1e-7;
+    int order = 2;
+    unsigned int min_substeps = 1;
+    unsigned int max_substeps = 1000;
+
+    double step = 0.0;     // 0 = nothing measured yet
+    double error = 0.0;
+
+    bool has_reference = false;
+    double reference_energy = 0.0;
+    double reference_momentum = 0.0;
+};
@@ -0,0 +1,124 @@
+#include "TestParticles.h"
+#include "../Common/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Particles per task
+    const size_t CHUNK = 1024;
+}
+
+// -------------Population----------------
+template <typename T>
+void TestParticles<T>::add(const sf::Vector2f& position, const sf::Vector2f& velocity)
+{
+    pos_x.push_back(position.x);
+    pos_y.push_back(position.y);
+    vel_x.push_back(velocity.x);
+    vel_y.push_back(velocity.y);
+    acc_x.push_back(T(0));
+    acc_y.push_back(T(0));
+    accel_valid = false;
+}
+
+template <typename T>
+void TestParticles<T>::clear()
+{
+    pos_x.clear(); pos_y.clear();
+    vel_x.clear(); vel_y.clear();
+    acc_x.clear(); acc_y.clear();
+    accel_valid = false;
+}
+
+template <typename T>
+void TestParticles<T>::reserve(size_t count)
+{
+    pos_x.reserve(count); pos_y.reserve(count);
+    vel_x.reserve(count); vel_y.reserve(count);
+    acc_x.reserve(count); acc_y.reserve(count);
+}
+
+// -------------Stepping----------------
+template <typename T>
+template <typename Job>
+void TestParticles<T>::for_each_chunk(const Job& job)
+{
+    const size_t n = pos_x.size();
+    const size_t chunks = (n + CHUNK - 1) / CHUNK;
+
+    if (pool && chunks > 1) {
+        pool->parallelTasks(chunks, [&](size_t c, unsigned int) {
+            job(c * CHUNK, std::min(n, (c + 1) * CHUNK));
+        });
+        return;
+    }
+
+    for (size_t c = 0; c < chunks; c++)
+        job(c * CHUNK, std::min(n, (c + 1) * CHUNK));
+}
+
+template <typename T>
+void TestParticles<T>::drift(T h)
+{
+    if (pos_x.empty()) return;
+
+    for_each_chunk([&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            pos_x[i] += vel_x[i] * h;
+            pos_y[i] += vel_y[i] * h;
+        }
+    });
+    accel_valid = false;
+}
+
+template <typename T>
+void TestParticles<T>::kick(T h, const T* src_x, const T* src_y, const T* src_mass, size_t src_count, T G, T epsilon)
+{
+    if (pos_x.empty()) return;
+
+    const bool evaluate = !accel_valid;
+    for_each_chunk([&](size_t begin, size_t end) {
+        if (evaluate)
+            accelerate(begin, end, src_x, src_y, src_mass, src_count, G, epsilon);
+
+        for (size_t i = begin; i < end; i++) {
+            vel_x[i] += acc_x[i] * h;
+            vel_y[i] += acc_y[i] * h;
+        }
+    });
+
+    if (evaluate) {
+        evaluations += pos_x.size();
+        accel_valid = true;
+    }
+}
+
+// Sources outermost: the inner loop runs over contiguous particles
+template <typename T>
+void TestParticles<T>::accelerate(size_t begin, size_t end, const T* src_x, const T* src_y, const T* src_mass,
+    size_t src_count, T G, T epsilon)
+{
+    for (size_t i = begin; i < end; i++) {
+        acc_x[i] = T(0);
+        acc_y[i] = T(0);
+    }
+
+    for (size_t j = 0; j < src_count; j++) {
+        const T sx = src_x[j], sy = src_y[j];
+        const T gm = G * src_mass[j];
+
+        for (size_t i = begin; i < end; i++) {
+            T dx = sx - pos_x[i];
+            T dy = sy - pos_y[i];
+            T dist = std::sqrt(dx * dx + dy * dy);
+
+            // Same singularity guard as the massive bodies
+            T scale = dist < epsilon ? T(0) : gm / (dist * dist * dist);
+            acc_x[i] += dx * scale;
+            acc_y[i] += dy * scale;
+        }
+    }
+}
+
+template class TestParticles<float>;
+template class TestParticles<double>;
@@ -0,0 +1,60 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+
+// Massless test particles (asteroid belts, rings, debris): attracted by the
+// massive bodies but exerting no force themselves, so a step costs
+// O(N_massive x N_test) and every particle can be updated independently.
+// State is structure-of-arrays in T, the scalar type of the world.
+//
+// The world moves them with the same stages as its splitting integrators
+// (drift / kick against the massive bodies at the same stage), or with a
+// kick-drift-kick leapfrog around the step of the massive bodies otherwise.
+// Accelerations stay cached until the particles or the sources move.
+template <typename T>
+class TestParticles
+{
+public:
+    void add(const sf::Vector2f& position, const sf::Vector2f& velocity);
+    void clear();
+    void reserve(size_t count);
+    size_t size() const { return pos_x.size(); }
+
+    sf::Vector2f get_position(size_t i) const {
+        return { static_cast<float>(pos_x[i]), static_cast<float>(pos_y[i]) };
+    }
+    sf::Vector2f get_velocity(size_t i) const {
+        return { static_cast<float>(vel_x[i]), static_cast<float>(vel_y[i]) };
+    }
+
+    // nullptr = update on the calling thread
+    void set_thread_pool(ThreadPool* p) { pool = p; }
+
+    // x += h v
+    void drift(T h);
+    // v += h a(sources), from the cached accelerations when still valid
+    void kick(T h, const T* src_x, const T* src_y, const T* src_mass, size_t src_count, T G, T epsilon);
+
+    // The sources moved or changed
+    void invalidate() { accel_valid = false; }
+
+    // Single-particle force evaluations so far
+    unsigned long long get_evaluations() const { return evaluations; }
+
+private:
+    std::vector<T> pos_x, pos_y;
+    std::vector<T> vel_x, vel_y;
+    std::vector<T> acc_x, acc_y;
+    bool accel_valid = false;
+    unsigned long long evaluations = 0;
+
+    ThreadPool* pool = nullptr;
+
+    void accelerate(size_t begin, size_t end, const T* src_x, const T* src_y, const T* src_mass,
+        size_t src_count, T G, T epsilon);
+    template <typename Job>
+    void for_each_chunk(const Job& job);
+};
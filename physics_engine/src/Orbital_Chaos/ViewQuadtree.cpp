@@ -0,0 +1,228 @@
+#include "ViewQuadtree.h"
+#include "../Common/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const int MAX_LEVEL = 16;   // 16 bits per axis in the Morton code
+
+    // Rebuild once the leaves cover this much more area than after a build
+    const float LOOSENESS = 2.f;
+
+    // Leaves fitted per task
+    const size_t LEAF_TASK = 4096;
+}
+
+// -------------Morton order----------------
+// Interleave the low 16 bits of v with zeros: ...dcba -> ...0d0c0b0a
+uint32_t ViewQuadtree::spread_bits(uint32_t v)
+{
+    v &= 0x0000FFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+void ViewQuadtree::sort_by_morton(const float* x, const float* y, size_t count)
+{
+    float min_x = x[0], max_x = x[0];
+    float min_y = y[0], max_y = y[0];
+    for (size_t i = 1; i < count; i++) {
+        min_x = std::min(min_x, x[i]); max_x = std::max(max_x, x[i]);
+        min_y = std::min(min_y, y[i]); max_y = std::max(max_y, y[i]);
+    }
+
+    float root_size = std::max(max_x - min_x, max_y - min_y) * 1.0001f;
+    if (root_size <= 0.f) root_size = 1.f;
+
+    codes.resize(count);
+    order.resize(count);
+    const float scale = 65535.f / root_size;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t qx = static_cast<uint32_t>(std::min(65535.f, (x[i] - min_x) * scale));
+        uint32_t qy = static_cast<uint32_t>(std::min(65535.f, (y[i] - min_y) * scale));
+        codes[i] = spread_bits(qx) | (spread_bits(qy) << 1);
+        order[i] = static_cast<uint32_t>(i);
+    }
+
+    // LSD radix sort, 4 passes of 8 bits
+    scratch_codes.resize(count);
+    scratch_order.resize(count);
+    for (int shift = 0; shift < 32; shift += 8) {
+        size_t histogram[257] = {};
+        for (size_t i = 0; i < count; i++)
+            histogram[((codes[i] >> shift) & 0xFF) + 1]++;
+        for (int b = 0; b < 256; b++)
+            histogram[b + 1] += histogram[b];
+
+        for (size_t i = 0; i < count; i++) {
+            size_t slot = histogram[(codes[i] >> shift) & 0xFF]++;
+            scratch_codes[slot] = codes[i];
+            scratch_order[slot] = order[i];
+        }
+        codes.swap(scratch_codes);
+        order.swap(scratch_order);
+    }
+}
+
+// -------------Build----------------
+void ViewQuadtree::build(const float* x, const float* y, const float* half_width, const float* half_height, size_t count)
+{
+    nodes.clear();
+    order.clear();
+    if (count == 0) return;
+
+    sort_by_morton(x, y, count);
+
+    // Breadth-first: children are contiguous and stored after their parent
+    nodes.push_back({ 0.f, 0.f, 0.f, 0.f, 0, 0, 0, static_cast<uint32_t>(count) });
+    levels.assign(1, 0);
+
+    for (size_t n = 0; n < nodes.size(); n++) {
+        const uint32_t begin = nodes[n].begin;
+        const uint32_t end = nodes[n].end;
+        const int level = levels[n];
+        if (end - begin <= leaf_size || level >= MAX_LEVEL) continue;
+
+        const int shift = 30 - 2 * level;
+        const uint32_t first_child = static_cast<uint32_t>(nodes.size());
+
+        uint32_t range_begin = begin;
+        for (uint32_t digit = 0; digit < 4; digit++) {
+            uint32_t range_end = end;
+            if (digit < 3) {
+                auto split = std::partition_point(codes.begin() + range_begin, codes.begin() + end,
+                    [&](uint32_t code) { return ((code >> shift) & 3u) <= digit; });
+                range_end = static_cast<uint32_t>(split - codes.begin());
+            }
+
+            if (range_end > range_begin) {
+                nodes.push_back({ 0.f, 0.f, 0.f, 0.f, 0, 0, range_begin, range_end });
+                levels.push_back(static_cast<uint8_t>(level + 1));
+            }
+            range_begin = range_end;
+        }
+
+        nodes[n].first_child = first_child;
+        nodes[n].child_count = static_cast<uint32_t>(nodes.size()) - first_child;
+    }
+
+    leaves.clear();
+    for (size_t n = 0; n < nodes.size(); n++)
+        if (nodes[n].child_count == 0) leaves.push_back(static_cast<uint32_t>(n));
+    leaf_areas.resize((leaves.size() + LEAF_TASK - 1) / LEAF_TASK);
+
+    built_area = fit_bounds(x, y, half_width, half_height);
+}
+
+void ViewQuadtree::refit(const float* x, const float* y, const float* half_width, const float* half_height)
+{
+    if (!nodes.empty()) fit_bounds(x, y, half_width, half_height);
+}
+
+void ViewQuadtree::update(const float* x, const float* y, const float* half_width, const float* half_height, size_t count)
+{
+    if (count != order.size() || nodes.empty()) {
+        build(x, y, half_width, half_height, count);
+        return;
+    }
+
+    const float area = fit_bounds(x, y, half_width, half_height);
+    if (area > LOOSENESS * built_area)
+        build(x, y, half_width, half_height, count);
+}
+
+// Bounds of every node: the leaves (gathering the items, in parallel
+// tasks), then the inner nodes children before parents. Returns the total
+// leaf area
+float ViewQuadtree::fit_bounds(const float* x, const float* y, const float* half_width, const float* half_height)
+{
+    auto fit_leaves = [&](size_t task) {
+        const size_t end = std::min(leaves.size(), (task + 1) * LEAF_TASK);
+        float area = 0.f;
+
+        for (size_t l = task * LEAF_TASK; l < end; l++) {
+            Node& node = nodes[leaves[l]];
+            float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+            for (uint32_t k = node.begin; k < node.end; k++) {
+                const uint32_t i = order[k];
+                const float hw = half_width ? half_width[i] : 0.f;
+                const float hh = half_height ? half_height[i] : 0.f;
+                min_x = std::min(min_x, x[i] - hw); max_x = std::max(max_x, x[i] + hw);
+                min_y = std::min(min_y, y[i] - hh); max_y = std::max(max_y, y[i] + hh);
+            }
+
+            node.min_x = min_x;
+            node.min_y = min_y;
+            node.max_x = max_x;
+            node.max_y = max_y;
+            area += (max_x - min_x) * (max_y - min_y);
+        }
+        leaf_areas[task] = area;
+    };
+
+    if (pool && leaf_areas.size() > 1)
+        pool->parallelTasks(leaf_areas.size(), [&](size_t task, unsigned int) { fit_leaves(task); });
+    else
+        for (size_t task = 0; task < leaf_areas.size(); task++) fit_leaves(task);
+
+    for (size_t n = nodes.size(); n-- > 0;) {
+        Node& node = nodes[n];
+        if (node.child_count == 0) continue;
+
+        float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+        for (uint32_t c = node.first_child; c < node.first_child + node.child_count; c++) {
+            min_x = std::min(min_x, nodes[c].min_x); max_x = std::max(max_x, nodes[c].max_x);
+            min_y = std::min(min_y, nodes[c].min_y); max_y = std::max(max_y, nodes[c].max_y);
+        }
+        node.min_x = min_x;
+        node.min_y = min_y;
+        node.max_x = max_x;
+        node.max_y = max_y;
+    }
+
+    float leaf_area = 0.f;
+    for (float area : leaf_areas)
+        leaf_area += area;
+    return leaf_area;
+}
+
+// -------------Query----------------
+void ViewQuadtree::query(const sf::FloatRect& rect, float cluster_size,
+    std::vector<uint32_t>& items, std::vector<uint32_t>& clusters) const
+{
+    items.clear();
+    clusters.clear();
+    if (nodes.empty()) return;
+
+    const float left = rect.position.x, right = rect.position.x + rect.size.x;
+    const float top = rect.position.y, bottom = rect.position.y + rect.size.y;
+
+    // At most 3 siblings wait per level
+    uint32_t stack[4 * MAX_LEVEL + 4];
+    int top_of_stack = 0;
+    stack[top_of_stack++] = 0;
+
+    while (top_of_stack > 0) {
+        const uint32_t n = stack[--top_of_stack];
+        const Node& node = nodes[n];
+        if (node.max_x < left || node.min_x > right || node.max_y < top || node.min_y > bottom) continue;
+
+        if (cluster_size > 0.f && node.end - node.begin > 1 &&
+            node.max_x - node.min_x <= cluster_size && node.max_y - node.min_y <= cluster_size) {
+            clusters.push_back(n);
+            continue;
+        }
+
+        if (node.child_count == 0) {
+            items.insert(items.end(), order.begin() + node.begin, order.begin() + node.end);
+            continue;
+        }
+
+        for (uint32_t c = node.first_child; c < node.first_child + node.child_count; c++)
+            stack[top_of_stack++] = c;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Quadtree of boxes for view culling and level of detail.
+// Items (bodies, particles, trails) are boxes centered at (x, y); they are
+// sorted by the Morton code of their centers and split top-down like the
+// Barnes-Hut tree, so every node covers a contiguous range of the order.
+// Nodes keep the bounds of their items, which may overlap their siblings'.
+//
+// Moving items are refitted (bounds recomputed bottom-up, the order kept)
+// while the leaves stay compact, and rebuilt once the total leaf area has
+// grown past twice what the last build gave.
+//
+// A query returns the items overlapping a rectangle, except where a whole
+// node is smaller than the cluster size: such nodes are returned as
+// clusters, to be drawn as one splat. The output is bounded by the visible
+// area over the cluster size, not by the number of items.
+class ThreadPool;
+
+class ViewQuadtree
+{
+public:
+    struct Node
+    {
+        float min_x, min_y, max_x, max_y;   // bounds of the items below
+        uint32_t first_child;               // children are contiguous
+        uint32_t child_count;               // 0 = leaf
+        uint32_t begin, end;                // range in get_order()
+    };
+
+    void set_leaf_size(uint32_t size) { leaf_size = size; }
+    // nullptr = fit the leaves on the calling thread
+    void set_thread_pool(ThreadPool* p) { pool = p; }
+
+    // Half sizes may be nullptr (points)
+    void build(const float* x, const float* y, const float* half_width, const float* half_height, size_t count);
+    // Bounds only, for the same items in the same order of indices
+    void refit(const float* x, const float* y, const float* half_width, const float* half_height);
+    // Refit, or build when the count changed or the leaves got too loose
+    void update(const float* x, const float* y, const float* half_width, const float* half_height, size_t count);
+
+    // Items of the leaves overlapping rect (indices into the build arrays;
+    // a few at the edges may lie just outside), and clusters (node indices)
+    // of nodes overlapping it but at most cluster_size wide and tall
+    // (0 never clusters)
+    void query(const sf::FloatRect& rect, float cluster_size,
+        std::vector<uint32_t>& items, std::vector<uint32_t>& clusters) const;
+
+    size_t size() const { return order.size(); }
+    const std::vector<Node>& get_nodes() const { return nodes; }
+    const std::vector<uint32_t>& get_order() const { return order; }
+
+private:
+    uint32_t leaf_size = 8;
+    ThreadPool* pool = nullptr;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> leaves;
+    std::vector<float> leaf_areas;
+    std::vector<uint8_t> levels;    // build scratch
+    float built_area = 0.f;         // total leaf area after the last build
+
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> codes;
+    std::vector<uint32_t> scratch_codes;
+    std::vector<uint32_t> scratch_order;
+
+    void sort_by_morton(const float* x, const float* y, size_t count);
+    float fit_bounds(const float* x, const float* y, const float* half_width, const float* half_height);
+    static uint32_t spread_bits(uint32_t v);
+};
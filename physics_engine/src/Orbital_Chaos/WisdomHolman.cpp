@@ -0,0 +1,301 @@
+#include "WisdomHolman.h"
+#include <cmath>
+
+namespace {
+    // Stumpff functions c0..c3 of z = beta s^2
+    void stumpff(double z, double& c0, double& c1, double& c2, double& c3)
+    {
+        if (std::abs(z) < 0.1) {
+            // Series: c_k(z) = sum (-z)^n / (2n + k)!
+            c0 = c1 = c2 = c3 = 0.0;
+            double term0 = 1.0, term1 = 1.0, term2 = 0.5, term3 = 1.0 / 6.0;
+            for (int n = 0; n < 8; n++) {
+                c0 += term0; c1 += term1; c2 += term2; c3 += term3;
+                term0 *= -z / ((2 * n + 1) * (2 * n + 2));
+                term1 *= -z / ((2 * n + 2) * (2 * n + 3));
+                term2 *= -z / ((2 * n + 3) * (2 * n + 4));
+                term3 *= -z / ((2 * n + 4) * (2 * n + 5));
+            }
+            return;
+        }
+
+        if (z > 0.0) {
+            double root = std::sqrt(z);
+            c0 = std::cos(root);
+            c1 = std::sin(root) / root;
+        }
+        else {
+            double root = std::sqrt(-z);
+            c0 = std::cosh(root);
+            c1 = std::sinh(root) / root;
+        }
+        c2 = (1.0 - c0) / z;
+        c3 = (1.0 - c1) / z;
+    }
+}
+
+// -------------Kepler drift----------------
+bool WisdomHolmanIntegrator::kepler_drift(double& x, double& y, double& vx, double& vy, double mu, double dt)
+{
+    const double r0 = std::sqrt(x * x + y * y);
+    if (r0 == 0.0 || mu <= 0.0) return false;
+
+    const double v2 = vx * vx + vy * vy;
+    const double beta = 2.0 * mu / r0 - v2;    // > 0 for bound orbits
+    const double eta0 = x * vx + y * vy;
+    const double zeta0 = mu - beta * r0;
+
+    // Kepler's equation in the universal variable s:
+    //   F(s) = r0 s + eta0 G2 + zeta0 G3 - t = 0,  F'(s) = r(s)
+    // with G_k = s^k c_k(beta s^2). Laguerre-Conway iteration
+    double t = dt;
+    double s = t / r0;
+
+    if (beta > 0.0) {
+        // Bound orbits repeat: reduce to (-P/2, P/2], then start from the
+        // mean rate ds/dt = beta / mu (a mean-anomaly guess)
+        const double period = 2.0 * 3.14159265358979323846 * mu / (beta * std::sqrt(beta));
+        t = std::fmod(t, period);
+        if (t > 0.5 * period) t -= period;
+        if (t < -0.5 * period) t += period;
+        s = t * beta / mu;
+    }
+
+    double c0, c1, c2, c3;
+    double g1 = 0.0, g2 = 0.0, g3 = 0.0, r = r0;
+    bool converged = false;
+    double residual = 0.0;
+
+    for (int iteration = 0; iteration < 50; iteration++) {
+        stumpff(beta * s * s, c0, c1, c2, c3);
+        g1 = s * c1;
+        g2 = s * s * c2;
+        g3 = s * s * s * c3;
+
+        double F = r0 * s + eta0 * g2 + zeta0 * g3 - t;
+        residual = F;
+        r = r0 + eta0 * g1 + zeta0 * g2;
+        double dF2 = eta0 * c0 + zeta0 * g1;
+
+        const double n = 5.0;
+        double root = std::sqrt(std::abs((n - 1.0) * (n - 1.0) * r * r - n * (n - 1.0) * F * dF2));
+        double denominator = r + (r >= 0.0 ? root : -root);
+        if (denominator == 0.0) break;
+
+        double ds = -n * F / denominator;
+        s += ds;
+
+        if (std::abs(ds) <= 1e-14 * std::abs(s) + 1e-300) {
+            converged = true;
+            break;
+        }
+    }
+
+    // Near-parabolic orbits can stall at round-off level; accept a tiny residual
+    if (!converged && !(std::abs(residual) <= 1e-10 * (std::abs(t) + r0 / std::sqrt(mu / r0))))
+        return false;
+
+    // Final G functions at the converged s
+    stumpff(beta * s * s, c0, c1, c2, c3);
+    g1 = s * c1;
+    g2 = s * s * c2;
+    g3 = s * s * s * c3;
+    r = r0 + eta0 * g1 + zeta0 * g2;
+
+    // Lagrange f and g functions
+    const double f = 1.0 - mu * g2 / r0;
+    const double g = t - mu * g3;
+    const double f_dot = -mu * g1 / (r0 * r);
+    const double g_dot = 1.0 - mu * g2 / r;
+
+    const double nx = f * x + g * vx, ny = f * y + g * vy;
+    vx = f_dot * x + g_dot * vx;
+    vy = f_dot * y + g_dot * vy;
+    x = nx;
+    y = ny;
+    return true;
+}
+
+// -------------Step----------------
+template <typename T>
+void WisdomHolmanIntegrator::step(T* pos_x, T* pos_y, T* vel_x, T* vel_y, const T* mass,
+    size_t count, double dt, double G, double epsilon)
+{
+    if (count == 0) return;
+    if (!initialized || masses.size() != count)
+        load(pos_x, pos_y, vel_x, vel_y, mass, count);
+
+    const double h = dt;
+    const double mu = G * central_mass;
+
+    interaction_kick(0.5 * h, G, epsilon);
+    jump(0.5 * h);
+
+    for (size_t i = 0; i < count; i++) {
+        if (i == central) continue;
+
+        // Falls back to a straight drift if the solver fails (e.g. r = 0)
+        if (!kepler_drift(helio_x[i], helio_y[i], bary_vx[i], bary_vy[i], mu, h)) {
+            helio_x[i] += bary_vx[i] * h;
+            helio_y[i] += bary_vy[i] * h;
+        }
+    }
+    kick_valid = false;
+
+    jump(0.5 * h);
+    interaction_kick(0.5 * h, G, epsilon);
+
+    com_x += com_vx * h;
+    com_y += com_vy * h;
+
+    store(pos_x, pos_y, vel_x, vel_y);
+}
+
+// Planet-planet gravity only; the central body is in the Kepler part
+void WisdomHolmanIntegrator::interaction_kick(double h, double G, double epsilon)
+{
+    const size_t count = masses.size();
+
+    if (!kick_valid) {
+        kick_x.assign(count, 0.0);
+        kick_y.assign(count, 0.0);
+        kick_potential = 0.0;
+
+        for (size_t i = 0; i < count; i++) {
+            if (i == central) continue;
+            for (size_t j = i + 1; j < count; j++) {
+                if (j == central) continue;
+
+                double dx = helio_x[j] - helio_x[i];
+                double dy = helio_y[j] - helio_y[i];
+                double dist = std::sqrt(dx * dx + dy * dy);
+                if (dist < epsilon) continue;
+
+                double inv_dist3 = G / (dist * dist * dist);
+                kick_potential -= G * masses[i] * masses[j] / dist;
+                kick_x[i] += dx * masses[j] * inv_dist3;
+                kick_y[i] += dy * masses[j] * inv_dist3;
+                kick_x[j] -= dx * masses[i] * inv_dist3;
+                kick_y[j] -= dy * masses[i] * inv_dist3;
+            }
+        }
+
+        body_evaluations += count;
+        kick_valid = true;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        bary_vx[i] += kick_x[i] * h;
+        bary_vy[i] += kick_y[i] * h;
+    }
+}
+
+bool WisdomHolmanIntegrator::potential_energy(double G, double epsilon, double& potential) const
+{
+    if (!initialized || !kick_valid) return false;
+
+    // Heliocentric distances are the star-planet separations
+    potential = kick_potential;
+    for (size_t i = 0; i < masses.size(); i++) {
+        if (i == central) continue;
+        double dist = std::sqrt(helio_x[i] * helio_x[i] + helio_y[i] * helio_y[i]);
+        if (dist < epsilon) continue;
+        potential -= G * central_mass * masses[i] / dist;
+    }
+    return true;
+}
+
+// Kinetic energy of the central body: every body drifts by P_total / m0
+void WisdomHolmanIntegrator::jump(double h)
+{
+    double px = 0.0, py = 0.0;
+    for (size_t i = 0; i < masses.size(); i++) {
+        if (i == central) continue;
+        px += masses[i] * bary_vx[i];
+        py += masses[i] * bary_vy[i];
+    }
+
+    const double shift_x = px / central_mass * h;
+    const double shift_y = py / central_mass * h;
+    for (size_t i = 0; i < masses.size(); i++) {
+        if (i == central) continue;
+        helio_x[i] += shift_x;
+        helio_y[i] += shift_y;
+    }
+    kick_valid = false;
+}
+
+// -------------Coordinates----------------
+template <typename T>
+void WisdomHolmanIntegrator::load(const T* pos_x, const T* pos_y, const T* vel_x, const T* vel_y,
+    const T* mass, size_t count)
+{
+    masses.assign(mass, mass + count);
+    helio_x.resize(count); helio_y.resize(count);
+    bary_vx.resize(count); bary_vy.resize(count);
+
+    // Heaviest body is the central one
+    central = 0;
+    for (size_t i = 1; i < count; i++)
+        if (masses[i] > masses[central]) central = i;
+    central_mass = masses[central];
+
+    total_mass = 0.0;
+    com_x = com_y = com_vx = com_vy = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        total_mass += masses[i];
+        com_x += masses[i] * pos_x[i];
+        com_y += masses[i] * pos_y[i];
+        com_vx += masses[i] * vel_x[i];
+        com_vy += masses[i] * vel_y[i];
+    }
+    com_x /= total_mass; com_y /= total_mass;
+    com_vx /= total_mass; com_vy /= total_mass;
+
+    for (size_t i = 0; i < count; i++) {
+        helio_x[i] = static_cast<double>(pos_x[i]) - pos_x[central];
+        helio_y[i] = static_cast<double>(pos_y[i]) - pos_y[central];
+        bary_vx[i] = vel_x[i] - com_vx;
+        bary_vy[i] = vel_y[i] - com_vy;
+    }
+
+    kick_valid = false;
+    initialized = true;
+}
+
+template <typename T>
+void WisdomHolmanIntegrator::store(T* pos_x, T* pos_y, T* vel_x, T* vel_y) const
+{
+    const size_t count = masses.size();
+
+    // Central body from the center of mass and the total momentum being zero
+    double offset_x = 0.0, offset_y = 0.0, px = 0.0, py = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        if (i == central) continue;
+        offset_x += masses[i] * helio_x[i];
+        offset_y += masses[i] * helio_y[i];
+        px += masses[i] * bary_vx[i];
+        py += masses[i] * bary_vy[i];
+    }
+
+    const double central_x = com_x - offset_x / total_mass;
+    const double central_y = com_y - offset_y / total_mass;
+
+    for (size_t i = 0; i < count; i++) {
+        if (i == central) {
+            pos_x[i] = static_cast<T>(central_x);
+            pos_y[i] = static_cast<T>(central_y);
+            vel_x[i] = static_cast<T>(com_vx - px / central_mass);
+            vel_y[i] = static_cast<T>(com_vy - py / central_mass);
+            continue;
+        }
+
+        pos_x[i] = static_cast<T>(central_x + helio_x[i]);
+        pos_y[i] = static_cast<T>(central_y + helio_y[i]);
+        vel_x[i] = static_cast<T>(com_vx + bary_vx[i]);
+        vel_y[i] = static_cast<T>(com_vy + bary_vy[i]);
+    }
+}
+
+template void WisdomHolmanIntegrator::step<float>(float*, float*, float*, float*, const float*, size_t, double, double, double);
+template void WisdomHolmanIntegrator::step<double>(double*, double*, double*, double*, const double*, size_t, double, double, double);
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Wisdom-Holman mapping in democratic heliocentric coordinates
+// (Duncan, Levison & Lee 1998) for systems dominated by one central body.
+// A step is: interaction kick h/2, jump h/2, Kepler drift h, jump h/2,
+// interaction kick h/2, where the drift moves every body on its exact
+// Kepler orbit around the central mass. Steps can be a sizeable fraction of
+// the shortest orbital period as long as no two planets get close.
+// The state is kept in double precision between calls; the arrays passed to
+// step() may be float or double.
+class WisdomHolmanIntegrator
+{
+public:
+    // Forget the internal state (re-read from the arrays on the next step)
+    void reset() { initialized = false; }
+
+    template <typename T>
+    void step(T* pos_x, T* pos_y, T* vel_x, T* vel_y, const T* mass, size_t count,
+        double dt, double G, double epsilon);
+
+    // Potential energy of the state left by the last step (star-planet terms
+    // plus the planet-planet pairs of its final kick); false if there is
+    // none, e.g. after a reset
+    bool potential_energy(double G, double epsilon, double& potential) const;
+
+    // Planet-planet force evaluations so far, counted per body
+    unsigned long long get_body_evaluations() const { return body_evaluations; }
+
+    // Advances a two-body orbit (relative position/velocity) by dt with the
+    // universal-variable formulation; works for any eccentricity.
+    // Returns false if the solver did not converge (state left unchanged)
+    static bool kepler_drift(double& x, double& y, double& vx, double& vy, double mu, double dt);
+
+private:
+    bool initialized = false;
+    unsigned long long body_evaluations = 0;
+
+    size_t central = 0;
+    double central_mass = 0.0, total_mass = 0.0;
+    double com_x = 0.0, com_y = 0.0, com_vx = 0.0, com_vy = 0.0;
+
+    // Heliocentric positions and barycentric velocities
+    std::vector<double> helio_x, helio_y, bary_vx, bary_vy, masses;
+    std::vector<double> kick_x, kick_y;
+    double kick_potential = 0.0;   // planet-planet pairs at the kick positions
+    bool kick_valid = false;
+
+    template <typename T>
+    void load(const T* pos_x, const T* pos_y, const T* vel_x, const T* vel_y, const T* mass, size_t count);
+    template <typename T>
+    void store(T* pos_x, T* pos_y, T* vel_x, T* vel_y) const;
+
+    void interaction_kick(double h, double G, double epsilon);
+    void jump(double h);
+};